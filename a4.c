@@ -10,6 +10,8 @@
 //---------------------------------------------------------------------------------------------------------------------
 //
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,11 +20,24 @@
 #include <stdbool.h>
 #include <time.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
 // ANSI color codes
 #define FLAGERRED_FIELD_COLOR "\033[31m"
 #define MINE_NORMAL_COLOR "\033[33m"
 #define MINE_HIGHLITED_COLOR "\033[33m\033[41m"
+#define PROBABILITY_COLOR "\033[36m"
 #define RESET_TEXT "\033[0m"
 
 // ASCII values for field items
@@ -49,15 +64,294 @@
 #define INVALID_COORDINATES "Error: Coordinates are invalid for this game board!\n"
 #define FAILED_TO_OPEN_FILE "Error: Failed to open file!\n"
 #define INVALID_FILE_CONTENT "Error: Invalid file content!\n"
+#define NO_MATCHING_LAYOUT "Error: No mine layout matches this board!\n"
+#define NO_GUESS_FAILED "Warning: No map without guessing was found, this one may need a guess!\n"
+#define NOTHING_TO_UNDO "Error: Nothing to undo!\n"
+#define NOTHING_TO_REDO "Error: Nothing to redo!\n"
+#define REGION_TOO_LARGE "Error: Region is too large for a procedural board!\n"
+
+// Limits of the mine probability solver
+#define PROB_MAX_STATES 4096         // states per field before the least likely ones are dropped
+#define PROB_EXACT_BUDGET 4000000ULL // stored polynomial entries per component for exact results
+#define PROB_TRIM 1e-18              // polynomial entries below this fraction of the maximum are dropped
+#define NO_GUESS_MAX_ATTEMPTS 100    // mine layouts tried before the last one is kept
+#define NO_GUESS_TARGET_DRAWS 64     // random picks when looking for a field to move a mine to or from
+#define SOLVER_UNKNOWN 0
+#define SOLVER_OPENED 1
+#define SOLVER_MINE 2
+#define STATS_COMMANDS 15
+#define STATS_UNAVAILABLE "Error: Statistics are not available in this build!\n"
+#define TRACE_MAGIC "ESPT"
+#define TRACE_VERSION 1
+#define TRACE_NO_GUESS 1             // flag bits of the trace header
+#define TRACE_PROCEDURAL 2
+#define GAME_CONTINUE -1             // processCommand: the game goes on
+#define COMMAND_MAX_WORDS 6          // words of a command line kept by splitCommandLine
+#define LINE_READ_SIZE 65536         // bytes of input requested per read
+#define LOAD_CHUNK_BLOCKS 4096       // blocks of a saved game read and decoded at once
+#define BOARD_POOL_SIZE 16           // freed boards the server keeps for new games of the same size
+#define SERVER_BACKLOG 64            // pending connections of the server
+#define SERVER_EVENTS 64             // events handled per wait of the server
+#define SERVER_MAX_LINE 4096         // bytes of a command line a session may send, longer ones close the connection
+#define COMMAND_START 0              // commands, in the order of stats_command_names
+#define COMMAND_OPEN 1
+#define COMMAND_FLAG 2
+#define COMMAND_DUMP 3
+#define COMMAND_SAVE 4
+#define COMMAND_LOAD 5
+#define COMMAND_QUIT 6
+#define COMMAND_PROB 7
+#define COMMAND_PROBMAP 8
+#define COMMAND_STATS 9
+#define COMMAND_UNDO 10
+#define COMMAND_REDO 11
+#define COMMAND_EXPORT 12
+#define COMMAND_REGION 13
+#define COMMAND_UNKNOWN 14
+
+// Counters for the hot paths, compiled out with -DA4_NO_STATS. Board output goes through RENDER_PRINTF so the printed
+// bytes can be counted.
+#ifndef A4_NO_STATS
+#define STATS_ADD(counter, amount) (game_stats.counter += (amount))
+#define STATS_PEAK(counter, peak)                                                                                    \
+  (game_stats.peak = game_stats.counter > game_stats.peak ? game_stats.counter : game_stats.peak)
+#define STATS_NOW() nowNanoseconds()
+#define RENDER_PRINTF(...) STATS_ADD(bytes_rendered, printf(__VA_ARGS__))
+#else
+#define STATS_ADD(counter, amount) ((void)(amount))
+#define STATS_PEAK(counter, peak) ((void)0)
+#define STATS_NOW() 0ULL
+#define RENDER_PRINTF(...) printf(__VA_ARGS__)
+#endif
+
+// Boards are printed through glyph tables, one per view, indexed by the state of a field: RENDER_ bits and the
+// adjacent bombs shifted by RENDER_COUNT_SHIFT.
+#define RENDER_VIEWS 4
+#define RENDER_VIEW_GAME 0   // the running game
+#define RENDER_VIEW_LOST 1   // all bombs, the one that was opened highlighted
+#define RENDER_VIEW_OPENED 2 // every field opened
+#define RENDER_VIEW_WON 3    // bombs and opened fields only
+#define RENDER_BOMB 1
+#define RENDER_OPENED 2
+#define RENDER_FLAGGED 4
+#define RENDER_COUNT_SHIFT 3
+#define RENDER_COUNT_MASK 15
+#define RENDER_HIGHLIGHT 128
+#define RENDER_ENCODINGS 3
+#define RENDER_ANSI 0                // colored glyphs, as the game prints them
+#define RENDER_PLAIN 1               // the same glyphs without escape sequences
+#define RENDER_COMPACT 2             // one byte per field, no borders
+#define RENDER_GLYPH_FLAG 0          // glyphs that differ between the encodings, the digits are the same in all of them
+#define RENDER_GLYPH_MINE 1
+#define RENDER_GLYPH_HIGHLIGHTED 2
+#define RENDER_GLYPH_CLOSED 3
+#define RENDER_GLYPH_ZERO 4
+#define RENDER_GLYPH_KINDS 5
+#define RENDER_CLOSED_LENGTH (sizeof("░") - 1) // the longest closed glyph
+#define RENDER_RUN_FIELDS 1024    // closed fields and border characters copied at once
+#define RENDER_BUFFER_SIZE 65536  // bytes of a board collected before they are written
+#define RENDER_PARALLEL_FIELDS (1ULL << 20) // smaller boards are printed by one thread
+#define RENDER_JOB_BYTES (1 << 22)          // bytes of rows a thread renders before they are written
+#define RENDER_MAX_THREADS 64
+#define EXPORT_MAX_TILE 65536        // fields per side of the square a pixel of an exported image stands for
 
 typedef struct _field_
 {
   bool is_bomb;
   bool is_opened;
-  int adjacent_bombs;
+  uint8_t adjacent_bombs;
   bool is_flagged;
 } myField;
 
+#define FIELD_CHANGED_OPENED 1
+#define FIELD_CHANGED_FLAGGED 2
+
+// Every move of the game that can be undone is kept as the runs of fields it changed. Applying a move or undoing it
+// toggles the same bits, so both cost time proportional to the move.
+typedef struct _delta_run_
+{
+  unsigned long long first;  // index of the first field, row * width + col
+  unsigned long long length;
+  uint8_t changed;           // FIELD_CHANGED_ bits toggled in every field of the run
+} myDeltaRun;
+
+typedef struct _move_
+{
+  size_t first_run;
+  size_t num_runs;
+  long long flags_delta;     // change of the remaining flags
+} myMove;
+
+typedef struct _history_
+{
+  myDeltaRun *runs;
+  size_t num_runs;
+  size_t runs_capacity;
+  myMove *moves;
+  size_t num_moves;
+  size_t moves_capacity;
+  size_t undone;             // moves at the end of the log which were undone and can be redone
+  bool failed;               // memory allocation failed while the current move was recorded
+} myHistory;
+
+// All fields live in one allocation, row-major by default. Built with -DA4_TILED_BOARD they are stored in tiles of
+// BOARD_TILE x BOARD_TILE fields instead, so the 3x3 neighbourhood of a field spans at most four tiles of 256 bytes
+// however wide the board is. Built with -DA4_TIERED_BOARD a tile is cold while none of its fields is flagged and
+// keeps only bit masks of its mines and opened fields; boardField() promotes it to a hot tile of myField when one of
+// its fields is changed, and a hot tile is demoted again once it is completely opened or closed without flags, so the
+// memory of the board follows the area being played rather than its size. Fields are only reached through
+// boardField(), or readBoardField() when they are not changed.
+#define BOARD_TILE_SHIFT 3
+#define BOARD_TILE (1 << BOARD_TILE_SHIFT)
+
+typedef struct _hot_tile_
+{
+  myField fields[BOARD_TILE * BOARD_TILE];
+  bool touched;              // listed in the touched tiles of the board
+} myHotTile;
+
+typedef struct _board_tile_
+{
+  uint64_t mines;            // mines of a cold tile, one bit per field, row by row
+  uint64_t opened;           // opened fields of a cold tile
+  myHotTile *hot;            // NULL while the tile is cold
+} myBoardTile;
+
+#ifdef A4_TIERED_BOARD
+#define BOARD_UNIT_SIZE sizeof(myBoardTile) // bytes of the board allocation per tile
+#else
+#define BOARD_UNIT_SIZE sizeof(myField)     // bytes of the board allocation per field
+#endif
+
+typedef struct _index_map_
+{
+  unsigned long long *keys; // field index (row * width + col), tile index or hash
+  size_t *values;           // SIZE_MAX marks an empty slot
+  size_t capacity;          // always a power of two
+  size_t size;
+} myIndexMap;
+
+typedef struct _board_tiers_
+{
+  myBoardTile *tiles;
+  size_t *touched;           // hot tiles changed since the board was last settled
+  size_t num_touched;
+  size_t touched_capacity;
+  bool failed;               // a tile could not be promoted, its change went to the spare field
+  myField spare;
+  myBoardTile *played;       // tiles of a procedural board, which has no tiles above, in the order they were played
+  size_t num_played;
+  size_t played_capacity;
+  myIndexMap directory;      // index of a tile -> its entry in played
+} myBoardTiers;
+
+// The mines of a procedural game are never stored: a field hides one if a hash of the seed and its position is below
+// a threshold chosen so the expected number of mines is the one given, and the starting field and its neighbours
+// never do. The tiered layout evaluates the hash whenever a field is read and allocates only the tiles which are
+// played, so the memory follows the fields opened and flagged however large the board is. Its closed fields without a
+// mine are only counted for the tiles which were played; the game is won once none are left there and no other tile
+// has a field without a mine.
+#define PROCEDURAL_COUNT_FIELDS (1ULL << 24) // larger boards take the mines given as their number of mines
+#define PROCEDURAL_REGION_FIELDS (1ULL << 24) // largest rectangle the region command counts field by field
+
+typedef struct _procedural_
+{
+  bool enabled;                 // the board of a procedural game, set before the board is sized
+  uint64_t key;                 // derived from the seed
+  uint64_t threshold;           // hashes below it are mines
+  unsigned long long start_row; // the starting field
+  unsigned long long start_col;
+  size_t safe_tile;             // no tile before it which was not played has a field without a mine
+} myProcedural;
+
+// A cascade works on bit planes of a window of the board, 64 fields per word. The first window spans this many rows
+// and words around the opened field and is grown while the opened region reaches its edge.
+#define CASCADE_WINDOW_ROWS 16
+#define CASCADE_WINDOW_WORDS 1
+
+// The engines of the presets keep the whole board in bit planes of one word per row.
+#define PRESET_MAX_HEIGHT 16
+#if defined(A4_TILED_BOARD) || defined(A4_TIERED_BOARD)
+#define PRESET_FIELD(board, row, col, width) boardField(board, row, col)
+#define PRESET_READ_FIELD(board, row, col, width) readBoardField(board, row, col)
+#else
+#define PRESET_FIELD(board, row, col, width) (&(board)->fields[(row) * (width) + (col)])
+#define PRESET_READ_FIELD(board, row, col, width) ((board)->fields[(row) * (width) + (col)])
+#endif
+
+// Mines are placed with the numbers of the random number generator drawn in batches of this many. The remainder of a
+// number divided by the fields left is found with the floating point reciprocal of the divisor, which is exact enough
+// from RANDOM_SMALL_DIVISOR on; smaller divisors are divided.
+#define RANDOM_BATCH 512
+#define RANDOM_SMALL_DIVISOR (1ULL << 13)
+
+// Region queries count the mines, opened and flagged fields of tiles of REGION_TILE x REGION_TILE fields and sum the
+// tiles up in a two-dimensional Fenwick tree. Every tile also keeps the counts of its first rows and of its first
+// columns, so a tile only the top or bottom or only the left or right edge of a query cuts through is counted in
+// constant time. A query takes logarithmic time plus one step per edge tile and the fields of its four corner tiles.
+#define REGION_TILE_SHIFT 4
+#define REGION_TILE (1 << REGION_TILE_SHIFT)
+#define REGION_MINES 0
+#define REGION_OPENED 1
+#define REGION_FLAGGED 2
+#define REGION_COUNTS 3
+
+typedef struct _region_index_
+{
+  unsigned long long tile_rows;
+  unsigned long long tile_columns;
+  unsigned long long (*tree)[REGION_COUNTS]; // Fenwick tree over the tiles, row by row
+  uint16_t (*counts)[REGION_COUNTS];         // counts of every tile as the tree holds them
+  uint8_t (*lines)[2][REGION_TILE][REGION_COUNTS]; // counts of every tile up to each of its rows and columns; the
+                                                  // last ones wrap around for a full tile, counts holds them instead
+  bool *dirty;                               // tiles with fields changed since the last query
+  size_t *dirty_tiles;                       // room for every tile, so marking one never allocates
+  size_t num_dirty;
+  bool stale;                                // all tiles are counted again, e.g. after mines were placed
+} myRegionIndex;
+
+// Totals of the fields of a board, kept up to date by every change of a field so they never need a scan of the board.
+typedef struct _board_counters_
+{
+  unsigned long long mines;
+  unsigned long long flags;
+  unsigned long long opened;
+  unsigned long long closed_safe; // fields neither opened nor mines, the game is won when none are left; only of the
+                                  // played tiles on a procedural board in the tiered layout
+} myBoardCounters;
+
+typedef struct _board_
+{
+  unsigned long long height;
+  unsigned long long width;
+  unsigned long long tile_columns; // tiles per row of tiles, only used by the tiled and tiered layouts
+  size_t num_fields;               // fields of the board, including the unused ones of partial tiles
+  size_t capacity;                 // fields or tiles the allocation has room for, reused when the board is resized
+  myField *fields;                 // NULL in the tiered layout
+  myBoardTiers tiers;              // only used by the tiered layout
+  myProcedural procedural;
+  myHistory *history;              // log the changed fields are recorded to, NULL to not record them
+  struct _board_pool_ *pool;       // pool the board is returned to when it is freed, NULL to release its memory
+  myRegionIndex *regions;          // built by the first region query, NULL before
+  myBoardCounters counters;
+} myBoard;
+
+typedef struct _board_pool_
+{
+  myBoard *boards[BOARD_POOL_SIZE];
+  size_t num_boards;
+} myBoardPool;
+
+// Boards of the standard sizes are played by engines specialized for their size at compile time, the generic code
+// plays all others.
+typedef struct _board_engine_
+{
+  const char *name;
+  unsigned long long height;
+  unsigned long long width;
+  int (*open_field)(myBoard *board, unsigned long long x, unsigned long long y, long long *remaining_flags);
+} myBoardEngine;
+
 typedef struct _block_
 {
   uint8_t valid_bits; // 8 bits
@@ -66,6 +360,41 @@ typedef struct _block_
   uint8_t flag_bits;  // 8 bits
 } myBlockField;
 
+typedef struct _glyph_
+{
+  char bytes[16]; // the bytes of the glyph, padded with zeros so they can be copied at once
+  uint8_t length;
+  bool counted;   // the glyph is picked again with the adjacent bombs of the field added to its state
+} myGlyph;
+
+typedef struct _render_buffer_
+{
+  char *data;
+  size_t length;
+  size_t capacity; // written to the output when full
+  FILE *output;
+} myRenderBuffer;
+
+typedef struct _render_frame_
+{
+  myBoard *board;
+  unsigned long long height;
+  unsigned long long width;
+  int view;                       // RENDER_VIEW_
+  int encoding;                   // RENDER_ANSI, RENDER_PLAIN or RENDER_COMPACT
+  unsigned long long highlight_x; // the field printed highlighted in the lost view
+  unsigned long long highlight_y;
+} myRenderFrame;
+
+typedef struct _render_job_
+{
+  const myRenderFrame *frame;
+  unsigned long long first_row;       // rows of the board the job renders
+  unsigned long long last_row;
+  myRenderBuffer buffer;              // large enough for the rows, it is never written out by the job
+  unsigned long long adjacent_counts; // calls of countAdjacentBombs, added to the counters of the printing thread
+} myRenderJob;
+
 typedef struct _bit_field_
 {
   char magic_number[4];           // 32 bits
@@ -74,1212 +403,7958 @@ typedef struct _bit_field_
   myBlockField *blocks_of_fields; // will point to 8 blocks because if each block is 4, 8x4 = 32
 } myBitField;
 
-void openAdjacentFields(myField **board, int x, int y, unsigned long long height, unsigned long long width, int *remaining_flags);
-int countAdjacentBombs(myField **board, int i, int j, unsigned long long height, unsigned long long width);
+typedef struct _prob_constraint_
+{
+  int target;       // mines hidden among the closed neighbours of an opened field
+  int num_fields;
+  size_t fields[8]; // frontier fields, or positions inside a component
+} myProbConstraint;
 
-//---------------------------------------------------------------------------------------------------------------------
-///
-/// This function checks if the given string represents a valid integer. A valid integer may start with an optional
-/// '+' or '-' sign followed by one or more digits. It returns 1 if the string is a valid integer, and 0 otherwise.
-///
-/// @param str The string to be checked for integer representation.
-///
-/// @return 1 if the string is a valid integer, 0 otherwise.
-//
-int isInteger(const char *str)
+typedef struct _frontier_
 {
-  if (*str == '-' || *str == '+')
-    str++;
+  myIndexMap index;               // field index -> frontier field
+  unsigned long long *fields;     // field index of each frontier field
+  size_t num_fields;
+  size_t fields_capacity;
+  myProbConstraint *constraints;
+  size_t num_constraints;
+  size_t constraints_capacity;
+  unsigned long long closed_fields; // all closed fields, frontier included
+  unsigned long long hidden_mines;  // mines which are not opened yet
+} myFrontier;
 
-  if (*str == '\0')
-    return 0;
+typedef struct _prob_component_
+{
+  uint64_t *signature; // fields and constraints of the component, used as cache key
+  size_t signature_length;
+  uint64_t hash;
+  unsigned long long generation;
+  size_t num_fields;
+  size_t *layer_start; // states before field i are layer_start[i] .. layer_start[i + 1] - 1
+  size_t *next_safe;   // successor state if the field is safe, SIZE_MAX if impossible
+  size_t *next_mine;   // successor state if the field is a mine, SIZE_MAX if impossible
+  size_t states_capacity;
+  bool exact;          // the mine count polynomials of all states are kept
+  bool pruned;         // states had to be dropped, results are approximate
+  size_t *poly_lo;     // per state: mine count of the first polynomial entry
+  size_t *poly_length;
+  size_t *poly_offset;
+  double *poly_pool;
+  size_t pool_size;
+  size_t pool_capacity;
+  size_t total_lo;     // mine count distribution of the whole component
+  size_t total_length;
+  double *total;
+} myProbComponent;
 
-  while (*str != '\0')
-  {
-    if (!isdigit((unsigned char)*str))
-      return 0; //
-    str++;
-  }
-  return 1;
-}
-//---------------------------------------------------------------------------------------------------------------------
-/// Prints a horizontal border.
-/// @param width Width of the border.
-//---------------------------------------------------------------------------------------------------------------------
-void printHorizontalBorder(unsigned long long width)
+typedef struct _prob_node_
 {
-  printf(" ");
-  printf(" ");
-  for (unsigned long long j = 0; j < width; j++)
-  {
-    printf("%c", HORIZONTAL_BORDER);
-  }
-  printf(" ");
-  // printf(EMPTY_SPACE);
+  size_t left;        // child nodes, SIZE_MAX for a leaf
+  size_t right;
+  size_t component;   // first component below the node
+  size_t lo;          // mine count of the first product entry
+  size_t length;
+  double *product;    // tilted mine count distribution of all components below the node
+  size_t need_lo;     // first mine count the weights are needed for
+  size_t need_length;
+  double *weights;    // weight of every mine count below the node, summed over all other components
+} myProbNode;
+
+typedef struct _prob_cache_
+{
+  bool valid;                   // probabilities match the current board
+  bool consistent;              // at least one mine layout matches the board
+  unsigned long long generation;
+  myIndexMap frontier;          // field index -> frontier field
+  double *probabilities;        // per frontier field
+  bool *approximate;            // per frontier field
+  double interior_probability;  // closed fields without opened neighbours
+  myProbComponent **components; // solved components, kept for the next query
+  size_t num_components;
+  myIndexMap component_index;   // component hash -> index into components
+} myProbCache;
+
+typedef struct _command_stats_
+{
+  unsigned long long count;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+} myCommandStats;
+
+typedef struct _stats_
+{
+  unsigned long long flood_fill_fields;    // fields visited by openField, including the cascade
+  unsigned long long adjacent_counts;      // calls of countAdjacentBombs
+  unsigned long long bytes_rendered;       // bytes printed for boards
+  unsigned long long random_numbers;       // 64-bit random numbers drawn
+  unsigned long long saved_bytes;
+  unsigned long long save_ns;
+  unsigned long long loaded_bytes;
+  unsigned long long load_ns;
+  unsigned long long board_allocations;    // allocations of board fields
+  unsigned long long board_reuses;         // resized boards whose fields fit into their allocation
+  unsigned long long board_bytes;          // bytes of board fields allocated now
+  unsigned long long board_peak_bytes;     // most bytes of board fields allocated at once
+  myCommandStats commands[STATS_COMMANDS]; // per entry of stats_command_names
+} myStats;
+
+typedef struct _random_
+{
+  uint32_t table[34]; // the last 34 numbers of the additive feedback generator used by rand()
+  int index;          // position of the oldest number
+} myRandom;
+
+typedef struct _solver_
+{
+  unsigned long long height;
+  unsigned long long width;
+  unsigned long long num_fields;  // fields the buffers are allocated for, kept between attempts
+  unsigned long long mines;
+  unsigned long long opened;
+  unsigned long long known_mines;
+  uint8_t *state;                 // SOLVER_UNKNOWN, SOLVER_OPENED or SOLVER_MINE per field
+  uint8_t *number;                // adjacent mines of an opened field
+  bool *queued;
+  size_t *work;                   // opened fields whose neighbourhood changed
+  size_t work_size;
+  size_t *cascade;                // safe fields waiting to be opened
+  size_t cascade_size;
+  size_t *candidates;             // opened fields with a number, picked from when the solver is stuck
+  size_t num_candidates;
+  size_t *unknown;                // fields which are neither opened nor known mines
+  size_t *unknown_position;       // index of a field in unknown
+  size_t num_unknown;
+  unsigned long long moves;       // fields opened by the player, not counting the opened area around empty fields
+  myRandom *random;               // generator for changes to the board, NULL for rand()
+} mySolver;
+
+typedef struct _simulation_
+{
+  unsigned long long height;
+  unsigned long long width;
+  unsigned long long count;
+  int first_seed;
+  bool no_guess;
+  unsigned long long games;
+  atomic_ullong next_game; // next game to be played by any worker
+  double *durations;       // microseconds per game
+} mySimulation;
+
+typedef struct _sim_worker_
+{
+  mySimulation *simulation;
+  unsigned long long played;
+  unsigned long long won;
+  unsigned long long moves;
+  unsigned long long guesses;
+  bool failed;
+} mySimWorker;
+
+typedef struct _game_
+{
+  unsigned long long height;
+  unsigned long long width;
+  unsigned long long count;    // number of mines
+  int seed;
+  bool no_guess;
+  bool procedural;             // mines follow from a hash of the seed and are never stored
+  int games;                   // games to simulate, 0 for an interactive game
+  int threads;                 // threads of the simulation, 0 for one per processor
+  bool stats_on_exit;
+  char *trace_file;            // file the commands are recorded to, NULL to not record them
+  char *replay_file;           // trace replayed instead of reading commands, NULL to read them from the input
+  char *serve_path;            // socket games are served on, NULL for a single game on the terminal
+  const myBoardEngine *engine; // engine specialized for the board size, NULL for the generic code
+  myBoard *board;
+  long long remaining_flags;
+  myProbCache prob_cache;
+  myHistory history;
+  FILE *trace;                 // open trace while recording
+  unsigned long long trace_ns; // time of the last recorded command
+} myGame;
+
+typedef struct _line_reader_
+{
+  int fd;
+  char *buffer;
+  size_t capacity;
+  size_t start;      // first byte of the next line
+  size_t searched;   // bytes after start known to contain no newline
+  size_t end;        // end of the input read so far
+  bool end_of_input;
+  size_t max_line;   // longest line accepted, 0 for lines of any length
+} myLineReader;
+
+typedef struct _session_
+{
+  int fd;
+  myGame game;
+  myLineReader reader;
+  FILE *capture;         // memory stream standing in for stdout while a command of the session runs
+  char *captured;        // the bytes of the capture, kept for the next command
+  size_t captured_size;
+  char *output;          // responses not yet sent
+  size_t output_size;
+  size_t output_sent;
+  size_t output_capacity;
+  uint32_t events;       // events the session waits for, EPOLLIN or EPOLLOUT while a response is pending
+  struct _session_ *previous; // sessions of the server, freed when it stops
+  struct _session_ *next;
+} mySession;
+
+// the only global state besides the tables of the renderer: counters are bumped deep inside the game functions, and
+// the boards are not printed while a trace is replayed; every thread keeps its own
+#ifndef A4_NO_STATS
+static _Thread_local myStats game_stats;
+#endif
+static _Thread_local bool render_suppressed;
+// set by SIGINT and SIGTERM to stop the server
+static volatile sig_atomic_t server_stopped;
+// the tables of the renderer are filled once and only read afterwards
+static const char *const render_encoded_glyphs[RENDER_ENCODINGS][RENDER_GLYPH_KINDS] = {
+    {FLAGERRED_FIELD_COLOR "¶" RESET_TEXT, MINE_NORMAL_COLOR "@" RESET_TEXT, MINE_HIGHLITED_COLOR "@" RESET_TEXT, "░",
+     "·"},
+    {"¶", "@", "@", "░", "·"},
+    {"F", "*", "*", "#", "."}};
+static myGlyph render_glyphs[RENDER_ENCODINGS][RENDER_VIEWS][256];
+static char render_closed_run[RENDER_ENCODINGS][RENDER_RUN_FIELDS * RENDER_CLOSED_LENGTH];
+static char render_border_run[RENDER_RUN_FIELDS];
+static pthread_once_t render_tables_once = PTHREAD_ONCE_INIT;
+static const char *const stats_command_names[STATS_COMMANDS] = {
+    "start", "open", "flag", "dump", "save", "load", "quit", "prob", "probmap", "stats", "undo", "redo", "export",
+    "region", "unknown"};
+
+int nextRandom(myRandom *random);
+unsigned long long nowNanoseconds();
+int countAdjacentBombs(myBoard *board, unsigned long long i, unsigned long long j, unsigned long long height,
+                       unsigned long long width);
+int reserveArray(void **array, size_t *capacity, size_t needed, size_t element_size);
+const myBoardEngine *findBoardEngine(unsigned long long height, unsigned long long width);
+
+uint64_t mixBits(uint64_t value);
+void freeIndexMap(myIndexMap *map);
+size_t findIndexMap(const myIndexMap *map, unsigned long long key);
+int insertIndexMap(myIndexMap *map, unsigned long long key, size_t value);
+
+#ifdef A4_TIERED_BOARD
+myField *touchBoardTile(myBoard *board, size_t tile, unsigned offset);
+myBoardTile *claimBoardTile(myBoard *board, size_t tile);
+myField readProceduralField(const myBoard *board, unsigned long long row, unsigned long long col);
+unsigned long long refreshProceduralTile(myBoard *board, size_t tile, myBoardTile *entry);
 
-  printf("\n");
-}
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints a representation of a closed field in a game, typically used to indicate an unrevealed or unselected area.
+/// Finds a tile of the tiered layout. A procedural board only has the tiles which were played.
+/// @param board A myBoard structure representing the game board.
+/// @param tile The index of the tile.
+/// @return A pointer to the tile, or NULL if the procedural board has not played it.
 //---------------------------------------------------------------------------------------------------------------------
-void printClosedField()
+static inline myBoardTile *findBoardTile(const myBoard *board, size_t tile)
 {
-  printf("░");
+  if (board->tiers.tiles != NULL)
+  {
+    return &board->tiers.tiles[tile];
+  }
+  size_t entry = findIndexMap(&board->tiers.directory, tile);
+  return entry == SIZE_MAX ? NULL : &board->tiers.played[entry];
 }
+#endif
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the game board when the player loses, revealing all bombs and the state of each field.
-/// @param board The game board represented as a 2D array of myField structures.
-/// @param bomb_x The x-coordinate of the bomb that caused the loss.
-/// @param bomb_y The y-coordinate of the bomb that caused the loss.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
+/// Returns whether a field of a procedural game hides a mine.
+/// @param procedural The seed-derived parameters of the board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @return Whether the field hides a mine.
 //---------------------------------------------------------------------------------------------------------------------
-void printLostField(myField **board, int bomb_x, int bomb_y, unsigned long long height, unsigned long long width)
+static inline bool isProceduralMine(const myProcedural *procedural, unsigned long long row, unsigned long long col)
 {
-  for (unsigned long long i = 0; i < height; i++)
+  if (row + 1 >= procedural->start_row && row <= procedural->start_row + 1 && col + 1 >= procedural->start_col &&
+      col <= procedural->start_col + 1)
   {
-    printf("%s", EMPTY_SPACE);
-    printf("%c", VERTICAL_BORDER);
-    for (unsigned long long j = 0; j < width; j++)
-    {
-      if (board[i][j].is_bomb == true)
-      {
-        if (i == bomb_x && j == bomb_y)
-        {
-          printf(MINE_HIGHLITED_COLOR "@" RESET_TEXT);
-        }
-        else
-        {
-          printf(MINE_NORMAL_COLOR "@" RESET_TEXT);
-        }
-      }
-      else if (board[i][j].is_opened == true)
-      {
-        board[i][j].adjacent_bombs = countAdjacentBombs(board, i, j, height, width);
-        if (board[i][j].adjacent_bombs == 0)
-        {
-          printf("·");
-        }
-        else
-        {
-          printf("%d", board[i][j].adjacent_bombs);
-        }
-      }
-      else
-      {
-        if (board[i][j].is_flagged)
-        {
-          printf(FLAGERRED_FIELD_COLOR "¶" RESET_TEXT);
-        }
-        else
-        {
-          printClosedField();
-        }
-      }
-    }
-    printf("%c", VERTICAL_BORDER);
-    printf("\n");
+    return false;
   }
+  return mixBits(mixBits(procedural->key ^ row) + col) < procedural->threshold;
 }
+
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the number of flags left for the player to use.
-/// @param flags_left The number of flags remaining.
+/// Returns the field at the given position of the board in the layout the game was built with, to be changed. In the
+/// tiered layout a cold tile is promoted first.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @return A pointer to the field, valid until the board is settled.
 //---------------------------------------------------------------------------------------------------------------------
-void printFlagsLeft(int flags_left)
+static inline myField *boardField(myBoard *board, unsigned long long row, unsigned long long col)
 {
-  printf("%s", EMPTY_SPACE);
-  printf("%s", EMPTY_SPACE);
-  printf(FLAGERRED_FIELD_COLOR "¶" RESET_TEXT);
-  printf(": %d\n", flags_left);
+#if defined(A4_TILED_BOARD) || defined(A4_TIERED_BOARD)
+  unsigned long long tile = (row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT);
+  unsigned long long offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+#ifdef A4_TIERED_BOARD
+  // the tiles of a procedural board are looked up by touchBoardTile
+  myHotTile *hot = board->tiers.tiles != NULL ? board->tiers.tiles[tile].hot : NULL;
+  if (hot == NULL || !hot->touched)
+  {
+    return touchBoardTile(board, tile, offset);
+  }
+  return &hot->fields[offset];
+#else
+  return &board->fields[tile << (2 * BOARD_TILE_SHIFT) | offset];
+#endif
+#else
+  return &board->fields[row * board->width + col];
+#endif
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the game board in the state when the player loses, including remaining flags and a special marker for the
-/// bomb that was triggered.
-/// @param board The game board, a 2D array of myField structures.
-/// @param x The x-coordinate of the triggered bomb.
-/// @param y The y-coordinate of the triggered bomb.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param remaining_flags The number of flags left for the player to use.
+/// Returns a copy of the field at the given position of the board without changing it. In the tiered layout a field
+/// of a cold tile is taken from its masks, or the hash of a procedural game, and has no adjacent bombs counted.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @return The field.
 //---------------------------------------------------------------------------------------------------------------------
-void printLostMap(myField **board, int x, int y, unsigned long long height, unsigned long long width, int remaining_flags)
+static inline myField readBoardField(const myBoard *board, unsigned long long row, unsigned long long col)
 {
-  printFlagsLeft(remaining_flags);
-  printHorizontalBorder(width);
-  printLostField(board, x, y, height, width);
-  printHorizontalBorder(width);
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled)
+  {
+    return readProceduralField(board, row, col);
+  }
+  unsigned long long offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+  const myBoardTile *tile =
+      &board->tiers.tiles[(row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT)];
+  if (tile->hot != NULL)
+  {
+    return tile->hot->fields[offset];
+  }
+  return (myField){(tile->mines >> offset & 1) != 0, (tile->opened >> offset & 1) != 0, 0, false};
+#else
+  return *boardField((myBoard *)board, row, col);
+#endif
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Validates a command line argument to ensure it is an integer and converts it to an integer value.
-/// @param arg The command line argument to be validated.
-/// @param value Pointer to an integer where the converted value will be stored if validation is successful.
-/// @return Returns 0 if the argument is successfully validated and converted, or 4 if the argument is not a valid integer.
+/// Returns whether a field of the board hides a mine, reading nothing else of the field, so the rows of a board can
+/// be counted on several threads while each of them stores the counts of its own fields.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @return Whether the field hides a mine.
 //---------------------------------------------------------------------------------------------------------------------
-int validateArgument(char *arg, int *value)
+static inline bool isBoardMine(const myBoard *board, unsigned long long row, unsigned long long col)
 {
-  if (!isInteger(arg))
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled)
   {
-    printf(INVALID_TYPE_FOR_ARGUMENT);
-    return 4;
+    return isProceduralMine(&board->procedural, row, col);
   }
-  *value = atoi(arg);
-  return 0;
+  unsigned long long offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+  const myBoardTile *tile =
+      &board->tiers.tiles[(row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT)];
+  return tile->hot != NULL ? tile->hot->fields[offset].is_bomb : (tile->mines >> offset & 1) != 0;
+#else
+  return boardField((myBoard *)board, row, col)->is_bomb;
+#endif
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints a mine character with normal color formatting.
+/// Sets whether a field of the board hides a mine. A cold tile of the tiered layout stays cold.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @param is_bomb Whether the field hides a mine.
 //---------------------------------------------------------------------------------------------------------------------
-void printMineNormal()
+static inline void setBoardMine(myBoard *board, unsigned long long row, unsigned long long col, bool is_bomb)
 {
-  printf(MINE_NORMAL_COLOR "%c" RESET_TEXT, 64);
+#ifdef A4_TIERED_BOARD
+  size_t index = (row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT);
+  myBoardTile *tile = board->tiers.tiles != NULL ? &board->tiers.tiles[index] : claimBoardTile(board, index);
+  if (tile == NULL)
+  {
+    board->tiers.failed = true;
+    return;
+  }
+  if (tile->hot == NULL)
+  {
+    unsigned offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+    tile->mines = (tile->mines & ~((uint64_t)1 << offset)) | (uint64_t)is_bomb << offset;
+    return;
+  }
+#endif
+  boardField(board, row, col)->is_bomb = is_bomb;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints a mine character with highlighted color formatting.
+/// Overwrites a field of the board. A cold tile of the tiered layout stays cold unless the field is flagged.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @param field The new state of the field.
 //---------------------------------------------------------------------------------------------------------------------
-void printMineHighlited()
+static inline void writeBoardField(myBoard *board, unsigned long long row, unsigned long long col, myField field)
 {
-  printf(MINE_HIGHLITED_COLOR "%c" RESET_TEXT, 64);
+#ifdef A4_TIERED_BOARD
+  size_t index = (row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT);
+  myBoardTile *tile = findBoardTile(board, index);
+  if (tile == NULL && !field.is_opened && !field.is_flagged)
+  {
+    // a procedural board leaves the tiles which were not played out
+    return;
+  }
+  tile = tile != NULL ? tile : claimBoardTile(board, index);
+  if (tile == NULL)
+  {
+    board->tiers.failed = true;
+    return;
+  }
+  if (tile->hot == NULL && !field.is_flagged)
+  {
+    unsigned offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+    tile->mines = (tile->mines & ~((uint64_t)1 << offset)) | (uint64_t)field.is_bomb << offset;
+    tile->opened = (tile->opened & ~((uint64_t)1 << offset)) | (uint64_t)field.is_opened << offset;
+    return;
+  }
+#endif
+  *boardField(board, row, col) = field;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Determines if a string represents a negative number.
-/// @param string The string to check.
-/// @return Returns 1 if the string starts with a '-', indicating a negative number, otherwise returns 0.
+/// Stores the number of adjacent bombs counted for a field of the board. A cold tile of the tiered layout does not
+/// keep it, it is counted again whenever the field is shown.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @param adjacent_bombs The number of adjacent bombs.
 //---------------------------------------------------------------------------------------------------------------------
-int isNegative(char *string)
+static inline void cacheAdjacentBombs(myBoard *board, unsigned long long row, unsigned long long col,
+                                      uint8_t adjacent_bombs)
 {
-  if (string[0] == '-')
+#ifdef A4_TIERED_BOARD
+  const myBoardTile *tile =
+      findBoardTile(board, (row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT));
+  myHotTile *hot = tile != NULL ? tile->hot : NULL;
+  if (hot != NULL)
   {
-    return 1;
+    unsigned offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+    hot->fields[offset].adjacent_bombs = adjacent_bombs;
   }
-  return 0;
+#else
+  boardField(board, row, col)->adjacent_bombs = adjacent_bombs;
+#endif
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Validates the command line arguments for height and width, ensuring they are positive integers and within allowed limits.
-/// @param index The starting index in argv for height and width arguments.
-/// @param argc The total number of command line arguments.
-/// @param argv The array of command line arguments.
-/// @param height Pointer to store the validated height value.
-/// @param width Pointer to store the validated width value.
-/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+/// Marks the tile of a changed field in the region index of the board, so the next query counts it again.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
 //---------------------------------------------------------------------------------------------------------------------
-int validateSizeArguments(int index, int argc, char *argv[], unsigned long long *height, unsigned long long *width)
+static inline void markRegionTile(myBoard *board, unsigned long long row, unsigned long long col)
 {
-  unsigned long long max_value = MAX_SIZE;
-
-  if (index + 2 >= argc)
+  myRegionIndex *regions = board->regions;
+  if (regions == NULL || regions->stale)
   {
-    printf(INVALID_NUMBER_OF_PARAMETERS);
-    return 2;
+    return;
   }
-
-  if (!isInteger(argv[index + 1]) || !isInteger(argv[index + 2]))
+  size_t tile = (row >> REGION_TILE_SHIFT) * regions->tile_columns + (col >> REGION_TILE_SHIFT);
+  if (!regions->dirty[tile])
   {
-    printf(INVALID_TYPE_FOR_ARGUMENT);
-    return 4;
+    regions->dirty[tile] = true;
+    regions->dirty_tiles[regions->num_dirty++] = tile;
   }
+}
 
-  if (isNegative(argv[index + 1]) || isNegative(argv[index + 2]))
+//---------------------------------------------------------------------------------------------------------------------
+/// Makes the next region query count all fields of the board again, after fields were changed without marking them.
+/// @param board A myBoard structure representing the game board.
+//---------------------------------------------------------------------------------------------------------------------
+static inline void invalidateRegionIndex(myBoard *board)
+{
+  if (board->regions != NULL)
   {
-    printf(INVALID_VALUE_FOR_ARGUMENT);
-    return 5;
+    board->regions->stale = true;
   }
+}
 
-  unsigned long long temp_height = strtoull(argv[index + 1], NULL, 10);
-  unsigned long long temp_width = strtoull(argv[index + 2], NULL, 10);
-
-  if (temp_height >= max_value || temp_width >= max_value)
+//---------------------------------------------------------------------------------------------------------------------
+/// Updates the counters of a board for a change of one of its fields. Called before the field is changed.
+/// @param board A myBoard structure representing the game board.
+/// @param field The field.
+/// @param changed The FIELD_CHANGED_ bits of the field that are toggled.
+//---------------------------------------------------------------------------------------------------------------------
+static inline void countFieldChange(myBoard *board, const myField *field, uint8_t changed)
+{
+  if (changed & FIELD_CHANGED_OPENED)
   {
-    printf(OUT_OF_MEMORY);
-    return 1;
+    long long delta = field->is_opened ? -1 : 1;
+    board->counters.opened += delta;
+    board->counters.closed_safe -= field->is_bomb ? 0 : delta;
   }
-
-  *height = temp_height;
-  *width = temp_width;
-
-  if (*height <= 1 || *width <= 1)
+  if (changed & FIELD_CHANGED_FLAGGED)
   {
-    printf(INVALID_VALUE_FOR_ARGUMENT);
-    return 5;
+    board->counters.flags += field->is_flagged ? -1 : 1;
   }
-
-  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Validates the command line arguments for the number of mines, ensuring the count is a positive integer and does not exceed the total number of fields.
-/// @param index The index in argv where the mine count argument is located.
-/// @param argc The total number of command line arguments.
-/// @param argv The array of command line arguments.
-/// @param count Pointer to store the validated mine count.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+/// Records a change of a field to the move the history of the board is recording, extending the last run of the move
+/// if the field follows it, marks its tile in the region index and updates the counters of the board. Called before
+/// the field is changed.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @param changed The FIELD_CHANGED_ bits of the field that are toggled.
 //---------------------------------------------------------------------------------------------------------------------
-int validateMinesArguments(int index, int argc, char *argv[], int *count, unsigned long long height, unsigned long long width)
+void recordFieldChange(myBoard *board, unsigned long long row, unsigned long long col, uint8_t changed)
 {
-  if (index + 1 >= argc)
+  myField current = readBoardField(board, row, col);
+  countFieldChange(board, &current, changed);
+  markRegionTile(board, row, col);
+  myHistory *history = board->history;
+  if (history == NULL || history->failed)
   {
-    printf(INVALID_NUMBER_OF_PARAMETERS);
-    return 2;
+    return;
   }
-
-  if (argv[index + 1][0] == '-' && !isInteger(argv[index + 1]))
+  unsigned long long field = row * board->width + col;
+  myDeltaRun *last = history->num_runs > history->moves[history->num_moves].first_run
+                         ? &history->runs[history->num_runs - 1]
+                         : NULL;
+  if (last != NULL && last->first + last->length == field && last->changed == changed)
   {
-    printf(INVALID_NUMBER_OF_PARAMETERS);
-    return 2;
+    last->length++;
+    return;
   }
-
-  int exit_code = validateArgument(argv[index + 1], count);
-  if (exit_code != 0)
+  if (reserveArray((void **)&history->runs, &history->runs_capacity, history->num_runs + 1, sizeof(myDeltaRun)) != 0)
   {
-    return exit_code;
+    history->failed = true;
+    return;
   }
+  history->runs[history->num_runs++] = (myDeltaRun){field, 1, changed};
+}
 
-  if (*count <= 0 || *count >= (height) * (width))
-  {
-    printf(INVALID_VALUE_FOR_ARGUMENT);
-    return 5;
-  }
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function checks if the given string represents a valid integer. A valid integer may start with an optional
+/// '+' or '-' sign followed by one or more digits. It returns 1 if the string is a valid integer, and 0 otherwise.
+///
+/// @param str The string to be checked for integer representation.
+///
+/// @return 1 if the string is a valid integer, 0 otherwise.
+//
+int isInteger(const char *str)
+{
+  if (*str == '-' || *str == '+')
+    str++;
 
-  return 0;
+  if (*str == '\0')
+    return 0;
+
+  while (*str != '\0')
+  {
+    if (!isdigit((unsigned char)*str))
+      return 0; //
+    str++;
+  }
+  return 1;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Validates the command line argument for the seed value, ensuring it is a positive integer.
-/// @param index The index in argv where the seed argument is located.
-/// @param argc The total number of command line arguments.
-/// @param argv The array of command line arguments.
-/// @param seed Pointer to a pointer to store the validated seed value.
-/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+/// Parses a coordinate or count: an optional '+' or '-' sign followed by one or more digits. The value is checked for
+/// overflow while it is parsed.
+/// @param word The argument to parse.
+/// @param limit The value must be below this, e.g. the height or width of the board for a coordinate.
+/// @param value Pointer to store the value.
+/// @return Returns 0 if the value is below the limit, 1 if the argument is not an integer, or 2 if it is negative or
+///         not below the limit.
 //---------------------------------------------------------------------------------------------------------------------
-int validateSeedArguments(int index, int argc, char *argv[], int **seed)
+int parseBoundedNumber(const char *word, unsigned long long limit, unsigned long long *value)
 {
-  if (index + 1 >= argc)
+  bool negative = *word == '-';
+  bool overflow = false;
+  if (*word == '-' || *word == '+')
   {
-    printf(INVALID_NUMBER_OF_PARAMETERS);
-    return 2;
+    word++;
   }
-
-  if (argv[index + 1][0] == '-' && !isInteger(argv[index + 1]))
+  if (*word == '\0')
   {
-    printf(INVALID_NUMBER_OF_PARAMETERS);
-    return 2;
+    return 1;
   }
 
-  int exit_code = validateArgument(argv[index + 1], *seed);
-  if (exit_code != 0)
+  *value = 0;
+  for (; *word != '\0'; word++)
   {
-    return exit_code;
+    if (!isdigit((unsigned char)*word))
+    {
+      return 1;
+    }
+    unsigned long long digit = *word - '0';
+    overflow = overflow || *value > (ULLONG_MAX - digit) / 10;
+    *value = *value * 10 + digit;
   }
 
-  if (**seed < 0)
+  if (overflow || (negative && *value != 0) || *value >= limit)
   {
-    printf(INVALID_VALUE_FOR_ARGUMENT);
-    return 5;
+    return 2;
   }
-
-  (**seed) = atoi(argv[index + 1]);
-  index += 1;
-
   return 0;
 }
-
 //---------------------------------------------------------------------------------------------------------------------
-/// Handles and validates all command line arguments for the game, including board size, number of mines, and seed value.
-/// @param argc The total number of command line arguments.
-/// @param argv The array of command line arguments.
-/// @param height Pointer to store the validated height of the game board.
-/// @param width Pointer to store the validated width of the game board.
-/// @param count Pointer to store the validated number of mines.
-/// @param seed Pointer to store the validated seed value for random number generation.
-/// @return Returns 0 if all arguments are successfully validated, or an error code indicating the type of validation failure.
+/// Prints a horizontal border.
+/// @param width Width of the border.
 //---------------------------------------------------------------------------------------------------------------------
-int handleCommandLineArguments(int argc, char *argv[], unsigned long long *height, unsigned long long *width, int *count, int *seed)
+void printHorizontalBorder(unsigned long long width)
 {
-  for (int index = 1; index < argc; index++)
+  RENDER_PRINTF(" ");
+  RENDER_PRINTF(" ");
+  for (unsigned long long j = 0; j < width; j++)
   {
-    if (strcmp(argv[index], "--size") == 0)
-    {
-      int exit_code = validateSizeArguments(index, argc, argv, height, width);
-      if (exit_code != 0)
-      {
-        return exit_code;
-      }
-      index += 2;
-    }
-    else if (strcmp(argv[index], "--mines") == 0)
-    {
-      int exit_code = validateMinesArguments(index, argc, argv, count, *height, *width);
-      if (exit_code != 0)
-      {
-        return exit_code;
-      }
-      index += 1;
-    }
-    else if (strcmp(argv[index], "--seed") == 0)
-    {
-      int exit_code = validateSeedArguments(index, argc, argv, &seed);
-      if (exit_code != 0)
-      {
-        printf(INVALID_TYPE_FOR_ARGUMENT);
-        return exit_code;
-      }
-      index += 1;
-    }
-    else
-    {
-      printf(UNEXPECTED_ARGUMENT);
-      return 3;
-    }
+    RENDER_PRINTF("%c", HORIZONTAL_BORDER);
   }
-  return 0;
-}
+  RENDER_PRINTF(" ");
+  // RENDER_PRINTF(EMPTY_SPACE);
 
+  RENDER_PRINTF("\n");
+}
 //---------------------------------------------------------------------------------------------------------------------
-/// Allocates memory for a game board of a specified size and initializes each field.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return Returns a pointer to the allocated game board or NULL if memory allocation fails.
+/// Describes how a field is printed in one view of the board, checking its state in the order the view always did.
+/// @param view The RENDER_VIEW_ the field is printed in.
+/// @param encoding The RENDER_ encoding of the output.
+/// @param state The state of the field, a combination of RENDER_ bits and the adjacent bombs shifted by
+///              RENDER_COUNT_SHIFT.
+/// @param glyph The glyph to fill in.
 //---------------------------------------------------------------------------------------------------------------------
-myField **allocateMemoryBoard(unsigned long long height, unsigned long long width)
+void describeGlyph(int view, int encoding, unsigned state, myGlyph *glyph)
 {
-  myField **board = malloc(height * sizeof(myField *));
-  if (board == NULL)
+  const char *const *encoded = render_encoded_glyphs[encoding];
+  bool bomb = (state & RENDER_BOMB) != 0;
+  bool opened = (state & RENDER_OPENED) != 0;
+  bool flagged = (state & RENDER_FLAGGED) != 0;
+  unsigned adjacent_bombs = (state >> RENDER_COUNT_SHIFT) & RENDER_COUNT_MASK;
+  char count[4];
+  snprintf(count, sizeof(count), "%u", adjacent_bombs);
+  const char *number = adjacent_bombs == 0 ? encoded[RENDER_GLYPH_ZERO] : count;
+
+  const char *bytes;
+  switch (view)
   {
-    printf(OUT_OF_MEMORY);
-    return NULL;
+    case RENDER_VIEW_GAME:
+      glyph->counted = !flagged && opened && !bomb;
+      bytes = flagged ? encoded[RENDER_GLYPH_FLAG]
+                      : (opened ? (bomb ? encoded[RENDER_GLYPH_MINE] : number) : encoded[RENDER_GLYPH_CLOSED]);
+      break;
+    case RENDER_VIEW_LOST:
+      glyph->counted = !bomb && opened;
+      bytes = encoded[(state & RENDER_HIGHLIGHT) ? RENDER_GLYPH_HIGHLIGHTED : RENDER_GLYPH_MINE];
+      bytes = bomb ? bytes : (opened ? number : encoded[flagged ? RENDER_GLYPH_FLAG : RENDER_GLYPH_CLOSED]);
+      break;
+    case RENDER_VIEW_OPENED:
+      glyph->counted = !bomb;
+      bytes = bomb ? encoded[RENDER_GLYPH_MINE] : number;
+      break;
+    default:
+      glyph->counted = !bomb && opened;
+      bytes = bomb ? encoded[RENDER_GLYPH_MINE] : (opened ? number : "");
+      break;
   }
+  memset(glyph->bytes, 0, sizeof(glyph->bytes));
+  glyph->length = strlen(bytes);
+  memcpy(glyph->bytes, bytes, glyph->length);
+}
 
-  for (unsigned long long i = 0; i < height; i++)
+//---------------------------------------------------------------------------------------------------------------------
+/// Fills the glyph tables of all encodings and views and the runs of closed fields and border characters. Called once
+/// through pthread_once before the first board is printed.
+//---------------------------------------------------------------------------------------------------------------------
+void buildRenderTables()
+{
+  for (int encoding = 0; encoding < RENDER_ENCODINGS; encoding++)
   {
-    board[i] = malloc(width * sizeof(myField));
-    if (board[i] == NULL)
+    for (int view = 0; view < RENDER_VIEWS; view++)
     {
-      printf(OUT_OF_MEMORY);
-      for (unsigned long long j = 0; j < i; j++)
+      for (unsigned state = 0; state < 256; state++)
       {
-        free(board[j]);
+        describeGlyph(view, encoding, state, &render_glyphs[encoding][view][state]);
       }
-      free(board);
-      return NULL;
     }
-    for (unsigned long long j = 0; j < width; j++)
+    const char *closed = render_encoded_glyphs[encoding][RENDER_GLYPH_CLOSED];
+    size_t length = strlen(closed);
+    for (size_t field = 0; field < RENDER_RUN_FIELDS; field++)
     {
-      board[i][j].is_bomb = false;
-      board[i][j].is_opened = false;
-      board[i][j].adjacent_bombs = 0;
-      board[i][j].is_flagged = false;
+      memcpy(render_closed_run[encoding] + field * length, closed, length);
     }
   }
+  memset(render_border_run, HORIZONTAL_BORDER, RENDER_RUN_FIELDS);
+}
 
-  return board;
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes the bytes collected in a render buffer to its output and empties it.
+/// @param buffer The render buffer.
+//---------------------------------------------------------------------------------------------------------------------
+void flushRender(myRenderBuffer *buffer)
+{
+  STATS_ADD(bytes_rendered, fwrite(buffer->data, 1, buffer->length, buffer->output));
+  buffer->length = 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Frees the allocated memory for the game board.
-/// @param board A pointer to the game board, a 2D array of myField structures.
-/// @param height The height of the game board, used to iterate through the first dimension.
+/// Appends bytes to a render buffer, writing it out first if they do not fit.
+/// @param buffer The render buffer.
+/// @param bytes The bytes to append.
+/// @param length The number of bytes, at most the capacity of the buffer.
 //---------------------------------------------------------------------------------------------------------------------
-void freeMemoryBoard(myField **board, unsigned long long height)
+static inline void renderBytes(myRenderBuffer *buffer, const char *bytes, size_t length)
 {
-  for (unsigned long long i = 0; i < height; i++)
+  if (buffer->capacity - buffer->length < length)
   {
-    free(board[i]);
+    flushRender(buffer);
   }
-  free(board);
+  memcpy(buffer->data + buffer->length, bytes, length);
+  buffer->length += length;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Generates a 64-bit random number by combining the results of two calls to rand().
-/// This function shifts the result of the first rand() call to the upper 32 bits and combines it with the result of
-/// a second rand() call to fill the lower 32 bits, creating a 64-bit random number.
-/// @return A 64-bit random number.
+/// Appends a character or glyph repeated a number of times to a render buffer, copying it from a prepared run.
+/// @param buffer The render buffer.
+/// @param run The run, RENDER_RUN_FIELDS copies of the glyph.
+/// @param length The number of bytes of the glyph.
+/// @param count The number of copies to append.
 //---------------------------------------------------------------------------------------------------------------------
-long long generate64BitRandomNumber()
+void renderRun(myRenderBuffer *buffer, const char *run, size_t length, unsigned long long count)
 {
-  long long upper_bits = rand();
-  long long lower_bits = rand();
-
-  upper_bits = upper_bits << 32;
-
-  long long fullNumber = upper_bits | lower_bits;
-
-  return fullNumber;
+  while (count > 0)
+  {
+    size_t copies = count < RENDER_RUN_FIELDS ? count : RENDER_RUN_FIELDS;
+    renderBytes(buffer, run, copies * length);
+    count -= copies;
+  }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Generates the game map by randomly placing mines on the board, except for the starting field.
-/// @param board A pointer to the game board, a 2D array of myField structures.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param count The total number of mines to place on the board.
-/// @param starting_field The index of the starting field, which will not contain a mine.
-/// @param seed A pointer to the seed value used for random number generation; if zero, the current time is used.
+/// Appends a horizontal border to a render buffer, the same bytes printHorizontalBorder prints. The compact encoding
+/// has no borders.
+/// @param buffer The render buffer.
+/// @param width Width of the border.
+/// @param encoding The RENDER_ encoding of the output.
 //---------------------------------------------------------------------------------------------------------------------
-void generateMap(myField **board, unsigned long long height, unsigned long long width, int count, int starting_field, int *seed)
+void renderBorder(myRenderBuffer *buffer, unsigned long long width, int encoding)
 {
-  unsigned long long fields_left = height * width - 1;
-  int mines_left = count;
-  int random_number;
-
-  if (seed != 0)
-  {
-    srand(*seed);
-  }
-  else
+  if (encoding == RENDER_COMPACT)
   {
-    srand(time(NULL));
+    return;
   }
+  renderBytes(buffer, "  ", 2);
+  renderRun(buffer, render_border_run, 1, width);
+  renderBytes(buffer, " \n", 2);
+}
 
-  for (unsigned long long row = 0; row < height; row++)
+//---------------------------------------------------------------------------------------------------------------------
+/// Appends rows of the game board to a render buffer. Every field is turned into a state byte that picks its bytes from
+/// the glyph table of the view and encoding; only the views that show the number of adjacent bombs of a field count
+/// them, storing the count in the field as before. A row without opened fields, flags and bombs is copied from the
+/// run of closed fields at once, as the state 0 prints a closed field or nothing in the views not counting it.
+/// @param frame The board and how it is printed.
+/// @param first_row The first row to append.
+/// @param last_row The row after the last one to append.
+/// @param buffer The render buffer.
+//---------------------------------------------------------------------------------------------------------------------
+void renderRows(const myRenderFrame *frame, unsigned long long first_row, unsigned long long last_row,
+                myRenderBuffer *buffer)
+{
+  myBoard *board = frame->board;
+  unsigned long long width = frame->width;
+  const myGlyph *glyphs = render_glyphs[frame->encoding][frame->view];
+  const char row_begin[2] = {EMPTY_SPACE[0], VERTICAL_BORDER};
+  const char row_end[2] = {VERTICAL_BORDER, '\n'};
+  size_t border = frame->encoding == RENDER_COMPACT ? 0 : 1; // bytes of the vertical borders besides the newline
+  for (unsigned long long i = first_row; i < last_row; i++)
   {
-    for (unsigned long long col = 0; col < width; col++)
+    renderBytes(buffer, row_begin, 2 * border);
+    bool closed_row = !glyphs[0].counted;
+    for (unsigned long long j = 0; j < width && closed_row; j++)
     {
-      if (row * width + col == starting_field)
-      {
-        board[row][col].is_bomb = false;
-        continue;
-      }
-
-      random_number = generate64BitRandomNumber() % fields_left;
-      if (random_number < mines_left)
-      {
-        board[row][col].is_bomb = true;
-        mines_left = mines_left - 1;
-      }
-      else
+      myField field = readBoardField(board, i, j);
+      closed_row = !(field.is_bomb | field.is_opened | field.is_flagged);
+    }
+    if (closed_row)
+    {
+      renderRun(buffer, render_closed_run[frame->encoding], glyphs[0].length, width);
+    }
+    else
+    {
+      for (unsigned long long j = 0; j < width; j++)
       {
-        board[row][col].is_bomb = false;
+        myField field = readBoardField(board, i, j);
+        unsigned state = field.is_bomb * RENDER_BOMB | field.is_opened * RENDER_OPENED |
+                         field.is_flagged * RENDER_FLAGGED |
+                         (i == frame->highlight_x && j == frame->highlight_y) * RENDER_HIGHLIGHT;
+        const myGlyph *glyph = &glyphs[state];
+        if (glyph->counted)
+        {
+          unsigned adjacent_bombs = countAdjacentBombs(board, i, j, frame->height, width);
+          cacheAdjacentBombs(board, i, j, adjacent_bombs);
+          glyph = &glyphs[state | adjacent_bombs << RENDER_COUNT_SHIFT];
+        }
+        if (buffer->capacity - buffer->length < sizeof(glyph->bytes))
+        {
+          flushRender(buffer);
+        }
+        memcpy(buffer->data + buffer->length, glyph->bytes, sizeof(glyph->bytes));
+        buffer->length += glyph->length;
       }
-      fields_left = fields_left - 1;
     }
+    renderBytes(buffer, row_end + 1 - border, 1 + border);
   }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Counts the number of bombs adjacent to a given field on the game board.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param i The row index of the field.
-/// @param j The column index of the field.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return The number of adjacent bombs.
+/// Renders the rows of a render job into its buffer, the start routine of the render threads.
+/// @param argument The myRenderJob.
+/// @return Returns NULL.
 //---------------------------------------------------------------------------------------------------------------------
-int countAdjacentBombs(myField **board, int i, int j, unsigned long long height, unsigned long long width)
+void *runRenderJob(void *argument)
 {
-  int adjacent_bombs = 0;
-  for (int x = -1; x <= 1; x++)
+  myRenderJob *job = argument;
+  job->buffer.length = 0;
+#ifndef A4_NO_STATS
+  unsigned long long adjacent_counts = game_stats.adjacent_counts;
+#endif
+  renderRows(job->frame, job->first_row, job->last_row, &job->buffer);
+#ifndef A4_NO_STATS
+  job->adjacent_counts = game_stats.adjacent_counts - adjacent_counts;
+#endif
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes the buffers of render jobs to the file descriptor of a stream in order, repeating the call on partial
+/// writes. A stream without one, such as the memory stream of a server session, takes the buffers one by one.
+/// @param output The stream, flushed before.
+/// @param jobs The render jobs.
+/// @param num_jobs The number of render jobs, at most RENDER_MAX_THREADS.
+//---------------------------------------------------------------------------------------------------------------------
+void writeRenderJobs(FILE *output, const myRenderJob *jobs, int num_jobs)
+{
+  int fd = fileno(output);
+  if (fd < 0)
   {
-    for (int y = -1; y <= 1; y++)
+    for (int job = 0; job < num_jobs; job++)
     {
-      unsigned long long new_x = x + i;
-      unsigned long long new_y = y + j;
-      if (new_x >= 0 && new_x < height && new_y >= 0 && new_y < width && board[new_x][new_y].is_bomb == true)
-      {
-        adjacent_bombs++;
-      }
+      STATS_ADD(bytes_rendered, fwrite(jobs[job].buffer.data, 1, jobs[job].buffer.length, output));
+    }
+    return;
+  }
+  struct iovec pieces[RENDER_MAX_THREADS];
+  for (int job = 0; job < num_jobs; job++)
+  {
+    pieces[job].iov_base = jobs[job].buffer.data;
+    pieces[job].iov_len = jobs[job].buffer.length;
+    STATS_ADD(bytes_rendered, jobs[job].buffer.length);
+  }
+  struct iovec *piece = pieces;
+  while (num_jobs > 0)
+  {
+    ssize_t written = writev(fd, piece, num_jobs);
+    if (written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (written <= 0)
+    {
+      return;
+    }
+    while (num_jobs > 0 && (size_t)written >= piece->iov_len)
+    {
+      written -= piece->iov_len;
+      piece++;
+      num_jobs--;
+    }
+    if (num_jobs > 0)
+    {
+      piece->iov_base = (char *)piece->iov_base + written;
+      piece->iov_len -= written;
     }
   }
-  return adjacent_bombs;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Opens a field on the game board. If the field is a bomb, the game ends. Otherwise, it reveals the number of adjacent bombs.
-/// If a field with no adjacent bombs is opened, adjacent fields are recursively opened.
-///
-/// @param board A 2D array of myField structures representing the game board.
-/// @param x The row index of the field to open.
-/// @param y The column index of the field to open.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
-///
-/// @return Returns 0 if the field was successfully opened, 1 if the coordinates are invalid, 2 if a bomb was opened,
-///         indicating the game is over.
+/// Appends all rows of a large board to the output in parallel. Rows are handed out in bands, one job of up to
+/// RENDER_JOB_BYTES per thread; the calling thread renders the first job of every band itself, and once all jobs of a
+/// band are done their buffers are written in order with one writev, so the output is the same as printing the rows
+/// one by one. The buffers are sized for the longest possible row, so memory stays bounded however large the board is.
+/// @param frame The board and how it is printed.
+/// @param buffer The render buffer holding the output so far, written out before the rows.
+/// @return Returns 0 if the rows were printed, or 1 if the board is too small or the buffers cannot be allocated, in
+///         which case nothing was printed.
 //---------------------------------------------------------------------------------------------------------------------
-int openField(myField **board, int x, int y, unsigned long long height, unsigned long long width, int *remaining_flags)
+int renderRowsInParallel(const myRenderFrame *frame, myRenderBuffer *buffer)
 {
-  if (x < 0 || x >= height || y < 0 || y >= width)
+  unsigned long long height = frame->height;
+  unsigned long long width = frame->width;
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = processors > RENDER_MAX_THREADS ? RENDER_MAX_THREADS : (int)processors;
+  threads = (unsigned long long)threads > height ? (int)height : threads;
+  if (threads < 2 || height * width < RENDER_PARALLEL_FIELDS || width > (SIZE_MAX / 2 - 4) / sizeof(myGlyph))
   {
-    printf(INVALID_COORDINATES);
     return 1;
   }
+  size_t row_bytes = 4 + width * sizeof(myGlyph); // room for the copy of a whole glyph at the end of a row
+  unsigned long long rows_per_job = RENDER_JOB_BYTES / row_bytes > 0 ? RENDER_JOB_BYTES / row_bytes : 1;
 
-  if (board[x][y].is_opened == true)
+  myRenderJob jobs[RENDER_MAX_THREADS];
+  pthread_t handles[RENDER_MAX_THREADS];
+  memset(jobs, 0, sizeof(jobs));
+  for (int job = 0; job < threads; job++)
   {
-    return 0;
+    jobs[job].frame = frame;
+    jobs[job].buffer.capacity = rows_per_job * row_bytes;
+    jobs[job].buffer.data = malloc(jobs[job].buffer.capacity);
+    jobs[job].buffer.output = buffer->output;
+    if (jobs[job].buffer.data == NULL)
+    {
+      for (int allocated = 0; allocated < job; allocated++)
+      {
+        free(jobs[allocated].buffer.data);
+      }
+      return 1;
+    }
   }
 
-  if (board[x][y].is_flagged)
+  flushRender(buffer);
+  fflush(buffer->output);
+  for (unsigned long long first_row = 0; first_row < height;)
   {
-    board[x][y].is_flagged = false;
-    (*remaining_flags)++;
+    int num_jobs = 0;
+    for (; num_jobs < threads && first_row < height; num_jobs++)
+    {
+      jobs[num_jobs].first_row = first_row;
+      jobs[num_jobs].last_row = height - first_row > rows_per_job ? first_row + rows_per_job : height;
+      first_row = jobs[num_jobs].last_row;
+    }
+    int started = 1;
+    for (; started < num_jobs; started++)
+    {
+      if (pthread_create(&handles[started], NULL, runRenderJob, &jobs[started]) != 0)
+      {
+        break;
+      }
+    }
+    for (int job = 0; job < num_jobs; job++)
+    {
+      if (job == 0 || job >= started)
+      {
+        runRenderJob(&jobs[job]); // counted on this thread already
+        continue;
+      }
+      pthread_join(handles[job], NULL);
+      STATS_ADD(adjacent_counts, jobs[job].adjacent_counts);
+    }
+    writeRenderJobs(buffer->output, jobs, num_jobs);
   }
 
-  if (board[x][y].is_bomb == true)
+  for (int job = 0; job < threads; job++)
   {
-    board[x][y].is_opened = true;
-    return 2;
+    free(jobs[job].buffer.data);
   }
+  return 0;
+}
 
-  int adjacent_bombs = countAdjacentBombs(board, x, y, height, width);
-  board[x][y].is_opened = true;
-  board[x][y].adjacent_bombs = adjacent_bombs;
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the game board between two horizontal borders. The output is collected in a buffer and written in pieces
+/// of RENDER_BUFFER_SIZE bytes, so a slow reader holds the game back instead of the output piling up in memory; the
+/// rows of large boards are rendered by renderRowsInParallel.
+/// @param frame The board and how it is printed.
+/// @param output The stream the board is written to.
+//---------------------------------------------------------------------------------------------------------------------
+void renderBoard(const myRenderFrame *frame, FILE *output)
+{
+  pthread_once(&render_tables_once, buildRenderTables);
+  char data[RENDER_BUFFER_SIZE];
+  myRenderBuffer buffer = {data, 0, RENDER_BUFFER_SIZE, output};
 
-  if (adjacent_bombs == 0)
+  renderBorder(&buffer, frame->width, frame->encoding);
+  if (renderRowsInParallel(frame, &buffer) != 0)
   {
-    openAdjacentFields(board, x, y, height, width, remaining_flags);
+    renderRows(frame, 0, frame->height, &buffer);
   }
+  renderBorder(&buffer, frame->width, frame->encoding);
+  flushRender(&buffer);
+}
 
-  return 0;
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the number of flags left for the player to use.
+/// @param flags_left The number of flags remaining.
+//---------------------------------------------------------------------------------------------------------------------
+void printFlagsLeft(long long flags_left)
+{
+  RENDER_PRINTF("%s", EMPTY_SPACE);
+  RENDER_PRINTF("%s", EMPTY_SPACE);
+  RENDER_PRINTF(FLAGERRED_FIELD_COLOR "¶" RESET_TEXT);
+  RENDER_PRINTF(": %lld\n", flags_left);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Recursively opens adjacent fields of a given field if they are not bombs and not already opened.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param x The row index of the current field.
-/// @param y The column index of the current field.
+/// Prints the game board in the state when the player loses, including remaining flags and a special marker for the
+/// bomb that was triggered.
+/// @param board The game board, a myBoard structure.
+/// @param x The x-coordinate of the triggered bomb.
+/// @param y The y-coordinate of the triggered bomb.
 /// @param height The height of the game board.
 /// @param width The width of the game board.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @param remaining_flags The number of flags left for the player to use.
 //---------------------------------------------------------------------------------------------------------------------
-void openAdjacentFields(myField **board, int x, int y, unsigned long long height, unsigned long long width, int *remaining_flags)
+void printLostMap(myBoard *board, unsigned long long x, unsigned long long y, unsigned long long height,
+                  unsigned long long width, long long remaining_flags)
 {
-  for (int i = -1; i <= 1; i++)
+  if (render_suppressed)
   {
-    for (int j = -1; j <= 1; j++)
-    {
-      unsigned long long new_x = i + x;
-      unsigned long long new_y = j + y;
-
-      if (new_x < 0 || new_x >= height || new_y < 0 || new_y >= width)
+    return;
+  }
+  printFlagsLeft(remaining_flags);
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_LOST, RENDER_ANSI, x, y}, stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates a command line argument to ensure it is an integer and converts it to an integer value.
+/// @param arg The command line argument to be validated.
+/// @param value Pointer to an integer where the converted value will be stored if validation is successful.
+/// @return Returns 0 if the argument is successfully validated and converted, or 4 if the argument is not a valid integer.
+//---------------------------------------------------------------------------------------------------------------------
+int validateArgument(char *arg, int *value)
+{
+  if (!isInteger(arg))
+  {
+    printf(INVALID_TYPE_FOR_ARGUMENT);
+    return 4;
+  }
+  *value = atoi(arg);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints a mine character with normal color formatting.
+//---------------------------------------------------------------------------------------------------------------------
+void printMineNormal()
+{
+  RENDER_PRINTF(MINE_NORMAL_COLOR "%c" RESET_TEXT, 64);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints a mine character with highlighted color formatting.
+//---------------------------------------------------------------------------------------------------------------------
+void printMineHighlited()
+{
+  RENDER_PRINTF(MINE_HIGHLITED_COLOR "%c" RESET_TEXT, 64);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Determines if a string represents a negative number.
+/// @param string The string to check.
+/// @return Returns 1 if the string starts with a '-', indicating a negative number, otherwise returns 0.
+//---------------------------------------------------------------------------------------------------------------------
+int isNegative(char *string)
+{
+  if (string[0] == '-')
+  {
+    return 1;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates the command line arguments for height and width, ensuring they are positive integers and within allowed limits.
+/// @param index The starting index in argv for height and width arguments.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param height Pointer to store the validated height value.
+/// @param width Pointer to store the validated width value.
+/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+//---------------------------------------------------------------------------------------------------------------------
+int validateSizeArguments(int index, int argc, char *argv[], unsigned long long *height, unsigned long long *width)
+{
+  unsigned long long max_value = MAX_SIZE;
+
+  if (index + 2 >= argc)
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  if (!isInteger(argv[index + 1]) || !isInteger(argv[index + 2]))
+  {
+    printf(INVALID_TYPE_FOR_ARGUMENT);
+    return 4;
+  }
+
+  if (isNegative(argv[index + 1]) || isNegative(argv[index + 2]))
+  {
+    printf(INVALID_VALUE_FOR_ARGUMENT);
+    return 5;
+  }
+
+  unsigned long long temp_height = strtoull(argv[index + 1], NULL, 10);
+  unsigned long long temp_width = strtoull(argv[index + 2], NULL, 10);
+
+  if (temp_height >= max_value || temp_width >= max_value)
+  {
+    printf(OUT_OF_MEMORY);
+    return 1;
+  }
+
+  *height = temp_height;
+  *width = temp_width;
+
+  if (*height <= 1 || *width <= 1)
+  {
+    printf(INVALID_VALUE_FOR_ARGUMENT);
+    return 5;
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates the command line arguments for the number of mines, ensuring the count is a positive integer and does not exceed the total number of fields.
+/// @param index The index in argv where the mine count argument is located.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param count Pointer to store the validated mine count.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+//---------------------------------------------------------------------------------------------------------------------
+int validateMinesArguments(int index, int argc, char *argv[], unsigned long long *count, unsigned long long height,
+                           unsigned long long width)
+{
+  if (index + 1 >= argc)
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  if (argv[index + 1][0] == '-' && !isInteger(argv[index + 1]))
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  unsigned long long fields = height > MAX_SIZE / width ? MAX_SIZE : height * width;
+  int result = parseBoundedNumber(argv[index + 1], fields, count);
+  if (result == 1)
+  {
+    printf(INVALID_TYPE_FOR_ARGUMENT);
+    return 4;
+  }
+
+  if (result != 0 || *count == 0)
+  {
+    printf(INVALID_VALUE_FOR_ARGUMENT);
+    return 5;
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates the command line argument for the seed value, ensuring it is a positive integer.
+/// @param index The index in argv where the seed argument is located.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param seed Pointer to a pointer to store the validated seed value.
+/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+//---------------------------------------------------------------------------------------------------------------------
+int validateSeedArguments(int index, int argc, char *argv[], int **seed)
+{
+  if (index + 1 >= argc)
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  if (argv[index + 1][0] == '-' && !isInteger(argv[index + 1]))
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  int exit_code = validateArgument(argv[index + 1], *seed);
+  if (exit_code != 0)
+  {
+    return exit_code;
+  }
+
+  if (**seed < 0)
+  {
+    printf(INVALID_VALUE_FOR_ARGUMENT);
+    return 5;
+  }
+
+  (**seed) = atoi(argv[index + 1]);
+  index += 1;
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates the command line argument for a count, such as the number of games or threads, ensuring it is an integer
+/// no larger than INT_MAX and positive unless zero is allowed.
+/// @param index The index in argv where the argument is located.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param zero_allowed True if 0 is a valid count, e.g. the number of threads picking one per processor.
+/// @param value Pointer to store the validated count.
+/// @return Returns 0 if validation is successful, or an error code indicating the type of validation failure.
+//---------------------------------------------------------------------------------------------------------------------
+int validateCountArgument(int index, int argc, char *argv[], bool zero_allowed, int *value)
+{
+  if (index + 1 >= argc || (argv[index + 1][0] == '-' && !isInteger(argv[index + 1])))
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+
+  unsigned long long count;
+  int result = parseBoundedNumber(argv[index + 1], (unsigned long long)INT_MAX + 1, &count);
+  if (result == 1)
+  {
+    printf(INVALID_TYPE_FOR_ARGUMENT);
+    return 4;
+  }
+
+  if (result != 0 || (count == 0 && !zero_allowed))
+  {
+    printf(INVALID_VALUE_FOR_ARGUMENT);
+    return 5;
+  }
+  *value = (int)count;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Validates the command line argument for a file name, which must follow the option.
+/// @param index The index in argv where the option is located.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param file Pointer to store the file name.
+/// @return Returns 0 if validation is successful, or 2 if the file name is missing.
+//---------------------------------------------------------------------------------------------------------------------
+int validateFileArgument(int index, int argc, char *argv[], char **file)
+{
+  if (index + 1 >= argc || argv[index + 1][0] == '-')
+  {
+    printf(INVALID_NUMBER_OF_PARAMETERS);
+    return 2;
+  }
+  *file = argv[index + 1];
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles and validates all command line arguments for the game, including board size, number of mines, and seed value.
+/// @param argc The total number of command line arguments.
+/// @param argv The array of command line arguments.
+/// @param game The game to store the validated settings in.
+/// @return Returns 0 if all arguments are successfully validated, or an error code indicating the type of validation failure.
+//---------------------------------------------------------------------------------------------------------------------
+int handleCommandLineArguments(int argc, char *argv[], myGame *game)
+{
+  int *seed = &game->seed;
+  for (int index = 1; index < argc; index++)
+  {
+    if (strcmp(argv[index], "--size") == 0)
+    {
+      int exit_code = validateSizeArguments(index, argc, argv, &game->height, &game->width);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 2;
+    }
+    else if (strcmp(argv[index], "--mines") == 0)
+    {
+      int exit_code = validateMinesArguments(index, argc, argv, &game->count, game->height, game->width);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--seed") == 0)
+    {
+      int exit_code = validateSeedArguments(index, argc, argv, &seed);
+      if (exit_code != 0)
+      {
+        printf(INVALID_TYPE_FOR_ARGUMENT);
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--no-guess") == 0)
+    {
+      game->no_guess = true;
+    }
+    else if (strcmp(argv[index], "--procedural") == 0)
+    {
+      game->procedural = true;
+    }
+    else if (strcmp(argv[index], "--stats-on-exit") == 0)
+    {
+      game->stats_on_exit = true;
+    }
+    else if (strcmp(argv[index], "--simulate") == 0)
+    {
+      int exit_code = validateCountArgument(index, argc, argv, false, &game->games);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--threads") == 0)
+    {
+      int exit_code = validateCountArgument(index, argc, argv, true, &game->threads);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--trace") == 0)
+    {
+      int exit_code = validateFileArgument(index, argc, argv, &game->trace_file);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--replay") == 0)
+    {
+      int exit_code = validateFileArgument(index, argc, argv, &game->replay_file);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else if (strcmp(argv[index], "--serve") == 0)
+    {
+      int exit_code = validateFileArgument(index, argc, argv, &game->serve_path);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      index += 1;
+    }
+    else
+    {
+      printf(UNEXPECTED_ARGUMENT);
+      return 3;
+    }
+  }
+  game->engine = findBoardEngine(game->height, game->width);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees a region index.
+/// @param regions The region index, or NULL.
+//---------------------------------------------------------------------------------------------------------------------
+void freeRegionIndex(myRegionIndex *regions)
+{
+  if (regions == NULL)
+  {
+    return;
+  }
+  free(regions->tree);
+  free(regions->counts);
+  free(regions->lines);
+  free(regions->dirty);
+  free(regions->dirty_tiles);
+  free(regions);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the mines, opened and flagged fields of a rectangle of the board by looking at every field.
+/// @param board A myBoard structure representing the game board.
+/// @param first_row The first row of the rectangle.
+/// @param first_col The first column of the rectangle.
+/// @param last_row The last row of the rectangle.
+/// @param last_col The last column of the rectangle.
+/// @param sums The counts to add to, indexed by REGION_MINES, REGION_OPENED and REGION_FLAGGED.
+//---------------------------------------------------------------------------------------------------------------------
+void countRegionFields(const myBoard *board, unsigned long long first_row, unsigned long long first_col,
+                       unsigned long long last_row, unsigned long long last_col,
+                       unsigned long long sums[REGION_COUNTS])
+{
+  // counted in locals, which the compiler keeps in registers as they cannot alias the board
+  unsigned long long mines = 0;
+  unsigned long long opened = 0;
+  unsigned long long flagged = 0;
+  for (unsigned long long row = first_row; row <= last_row; row++)
+  {
+    for (unsigned long long col = first_col; col <= last_col; col++)
+    {
+      myField field = readBoardField(board, row, col);
+      mines += field.is_bomb;
+      opened += field.is_opened;
+      flagged += field.is_flagged;
+    }
+  }
+  sums[REGION_MINES] += mines;
+  sums[REGION_OPENED] += opened;
+  sums[REGION_FLAGGED] += flagged;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the fields of one tile of the region index again, up to each of its rows and columns, and adds the difference
+/// of its counts to what the Fenwick tree holds.
+/// @param board A myBoard structure representing the game board.
+/// @param tile The index of the tile, row by row.
+/// @param update True to add the difference to the tree, false if the tree is built from the counts afterwards.
+//---------------------------------------------------------------------------------------------------------------------
+void recountRegionTile(const myBoard *board, size_t tile, bool update)
+{
+  myRegionIndex *regions = board->regions;
+  unsigned long long tile_row = tile / regions->tile_columns;
+  unsigned long long tile_col = tile % regions->tile_columns;
+  unsigned long long first_row = tile_row << REGION_TILE_SHIFT;
+  unsigned long long first_col = tile_col << REGION_TILE_SHIFT;
+  unsigned rows = board->height - first_row > REGION_TILE ? REGION_TILE : board->height - first_row;
+  unsigned cols = board->width - first_col > REGION_TILE ? REGION_TILE : board->width - first_col;
+  unsigned row_counts[REGION_TILE][REGION_COUNTS];
+  unsigned col_counts[REGION_TILE][REGION_COUNTS];
+  memset(row_counts, 0, sizeof(row_counts));
+  memset(col_counts, 0, sizeof(col_counts));
+  for (unsigned row = 0; row < rows; row++)
+  {
+    for (unsigned col = 0; col < cols; col++)
+    {
+      myField field = readBoardField(board, first_row + row, first_col + col);
+      row_counts[row][REGION_MINES] += field.is_bomb;
+      row_counts[row][REGION_OPENED] += field.is_opened;
+      row_counts[row][REGION_FLAGGED] += field.is_flagged;
+      col_counts[col][REGION_MINES] += field.is_bomb;
+      col_counts[col][REGION_OPENED] += field.is_opened;
+      col_counts[col][REGION_FLAGGED] += field.is_flagged;
+    }
+  }
+
+  unsigned counts[REGION_COUNTS] = {0, 0, 0};
+  unsigned col_total[REGION_COUNTS] = {0, 0, 0};
+  for (unsigned line = 0; line < REGION_TILE; line++)
+  {
+    for (int kind = 0; kind < REGION_COUNTS; kind++)
+    {
+      counts[kind] += row_counts[line][kind];
+      col_total[kind] += col_counts[line][kind];
+      regions->lines[tile][0][line][kind] = (uint8_t)counts[kind];
+      regions->lines[tile][1][line][kind] = (uint8_t)col_total[kind];
+    }
+  }
+
+  for (int kind = 0; kind < REGION_COUNTS; kind++)
+  {
+    // wraps around for fewer fields
+    unsigned long long delta = (unsigned long long)counts[kind] - regions->counts[tile][kind];
+    regions->counts[tile][kind] = counts[kind];
+    if (!update || delta == 0)
+    {
+      continue;
+    }
+    for (unsigned long long i = tile_row + 1; i <= regions->tile_rows; i += i & -i)
+    {
+      for (unsigned long long j = tile_col + 1; j <= regions->tile_columns; j += j & -j)
+      {
+        regions->tree[(i - 1) * regions->tile_columns + j - 1][kind] += delta;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Builds the Fenwick tree of the region index from the counts of all tiles in linear time: every node passes its sum
+/// on to its parent along the rows, then along the columns.
+/// @param regions The region index.
+//---------------------------------------------------------------------------------------------------------------------
+void buildRegionTree(myRegionIndex *regions)
+{
+  unsigned long long rows = regions->tile_rows;
+  unsigned long long columns = regions->tile_columns;
+  for (size_t tile = 0; tile < rows * columns; tile++)
+  {
+    for (int kind = 0; kind < REGION_COUNTS; kind++)
+    {
+      regions->tree[tile][kind] = regions->counts[tile][kind];
+    }
+  }
+  for (unsigned long long i = 1; i <= rows; i++)
+  {
+    for (unsigned long long j = 1; j <= columns; j++)
+    {
+      unsigned long long parent_column = j + (j & -j);
+      for (int kind = 0; kind < REGION_COUNTS && parent_column <= columns; kind++)
+      {
+        regions->tree[(i - 1) * columns + parent_column - 1][kind] += regions->tree[(i - 1) * columns + j - 1][kind];
+      }
+    }
+  }
+  for (unsigned long long i = 1; i <= rows; i++)
+  {
+    unsigned long long parent_row = i + (i & -i);
+    for (unsigned long long j = 1; j <= columns && parent_row <= rows; j++)
+    {
+      for (int kind = 0; kind < REGION_COUNTS; kind++)
+      {
+        regions->tree[(parent_row - 1) * columns + j - 1][kind] += regions->tree[(i - 1) * columns + j - 1][kind];
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Brings the region index of a board up to date, creating it on the first call. A stale index counts every tile
+/// again; otherwise only the tiles marked since the last call are counted, and if they are many the tree is built
+/// again instead of being updated tile by tile.
+/// @param board A myBoard structure representing the game board.
+/// @return Returns 0 on success or 1 if memory allocation fails, which leaves the board without an index.
+//---------------------------------------------------------------------------------------------------------------------
+int updateRegionIndex(myBoard *board)
+{
+  myRegionIndex *regions = board->regions;
+  unsigned long long rows = (board->height >> REGION_TILE_SHIFT) + ((board->height & (REGION_TILE - 1)) != 0);
+  unsigned long long columns = (board->width >> REGION_TILE_SHIFT) + ((board->width & (REGION_TILE - 1)) != 0);
+  if (regions == NULL || (regions->stale && (regions->tile_rows != rows || regions->tile_columns != columns)))
+  {
+    freeRegionIndex(regions);
+    board->regions = regions = calloc(1, sizeof(myRegionIndex));
+    size_t tiles = rows * columns > 0 ? rows * columns : 1;
+    if (regions == NULL || (regions->tree = calloc(tiles, sizeof(*regions->tree))) == NULL ||
+        (regions->counts = calloc(tiles, sizeof(*regions->counts))) == NULL ||
+        (regions->lines = calloc(tiles, sizeof(*regions->lines))) == NULL ||
+        (regions->dirty = calloc(tiles, sizeof(bool))) == NULL ||
+        (regions->dirty_tiles = malloc(tiles * sizeof(size_t))) == NULL)
+    {
+      freeRegionIndex(regions);
+      board->regions = NULL;
+      return 1;
+    }
+    regions->tile_rows = rows;
+    regions->tile_columns = columns;
+    regions->stale = true;
+  }
+
+  size_t tiles = rows * columns;
+  if (regions->stale)
+  {
+    for (size_t tile = 0; tile < tiles; tile++)
+    {
+      recountRegionTile(board, tile, false);
+      regions->dirty[tile] = false;
+    }
+    buildRegionTree(regions);
+  }
+  else
+  {
+    bool rebuild = regions->num_dirty > tiles / 16;
+    for (size_t dirty = 0; dirty < regions->num_dirty; dirty++)
+    {
+      recountRegionTile(board, regions->dirty_tiles[dirty], !rebuild);
+      regions->dirty[regions->dirty_tiles[dirty]] = false;
+    }
+    if (rebuild)
+    {
+      buildRegionTree(regions);
+    }
+  }
+  regions->num_dirty = 0;
+  regions->stale = false;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Sums up the counts of the tiles above and left of a tile of the region index.
+/// @param regions The region index.
+/// @param tile_rows The number of tile rows to sum up from the top.
+/// @param tile_columns The number of tile columns to sum up from the left.
+/// @param sums The counts to add to; subtracted from if negative is set.
+/// @param negative True to subtract the counts.
+//---------------------------------------------------------------------------------------------------------------------
+void sumRegionTiles(const myRegionIndex *regions, unsigned long long tile_rows, unsigned long long tile_columns,
+                    unsigned long long sums[REGION_COUNTS], bool negative)
+{
+  for (unsigned long long i = tile_rows; i > 0; i -= i & -i)
+  {
+    for (unsigned long long j = tile_columns; j > 0; j -= j & -j)
+    {
+      for (int kind = 0; kind < REGION_COUNTS; kind++)
+      {
+        unsigned long long count = regions->tree[(i - 1) * regions->tile_columns + j - 1][kind];
+        sums[kind] += negative ? -count : count;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the mines, opened and flagged fields of a span of whole rows or columns of one tile of the region index.
+/// @param regions The region index.
+/// @param tile The index of the tile, row by row.
+/// @param axis 0 for a span of rows, 1 for a span of columns.
+/// @param first The first row or column of the span in the tile.
+/// @param last The last row or column of the span in the tile.
+/// @param sums The counts to add to.
+//---------------------------------------------------------------------------------------------------------------------
+void sumTileLines(const myRegionIndex *regions, size_t tile, int axis, unsigned first, unsigned last,
+                  unsigned long long sums[REGION_COUNTS])
+{
+  uint8_t (*lines)[REGION_COUNTS] = regions->lines[tile][axis];
+  for (int kind = 0; kind < REGION_COUNTS; kind++)
+  {
+    unsigned count = last < REGION_TILE - 1 ? lines[last][kind] : regions->counts[tile][kind];
+    sums[kind] += count - (first > 0 ? lines[first - 1][kind] : 0);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the mines, opened and flagged fields of a rectangle of the board. The whole tiles inside the rectangle are
+/// summed up by the Fenwick tree of the region index, the tiles one of its edges cuts through by the counts of their
+/// rows or columns and the corner tiles two edges cut through field by field. A procedural board in the tiered layout
+/// has no index, which would cover all of its fields, and counts the rectangle field by field, so it refuses
+/// rectangles of more than PROCEDURAL_REGION_FIELDS fields.
+/// @param board A myBoard structure representing the game board.
+/// @param first_row The first row of the rectangle.
+/// @param first_col The first column of the rectangle.
+/// @param last_row The last row of the rectangle, at least first_row and below the height of the board.
+/// @param last_col The last column of the rectangle, at least first_col and below the width of the board.
+/// @param sums Pointer to store the counts, indexed by REGION_MINES, REGION_OPENED and REGION_FLAGGED.
+/// @return Returns 0 on success, 1 if memory allocation fails, or 2 if the rectangle is too large to be counted.
+//---------------------------------------------------------------------------------------------------------------------
+int queryRegion(myBoard *board, unsigned long long first_row, unsigned long long first_col,
+                unsigned long long last_row, unsigned long long last_col, unsigned long long sums[REGION_COUNTS])
+{
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled)
+  {
+    // the height of the rectangle is at most the number of fields, which keeps the product from overflowing
+    unsigned long long rows = last_row - first_row + 1;
+    if (rows > PROCEDURAL_REGION_FIELDS || last_col - first_col + 1 > PROCEDURAL_REGION_FIELDS / rows)
+    {
+      return 2;
+    }
+    memset(sums, 0, REGION_COUNTS * sizeof(unsigned long long));
+    countRegionFields(board, first_row, first_col, last_row, last_col, sums);
+    return 0;
+  }
+#endif
+  if (updateRegionIndex(board) != 0)
+  {
+    return 1;
+  }
+  const myRegionIndex *regions = board->regions;
+  memset(sums, 0, REGION_COUNTS * sizeof(unsigned long long));
+  // the whole tiles span tile rows [top, bottom) and tile columns [left, right)
+  unsigned long long top = (first_row + REGION_TILE - 1) >> REGION_TILE_SHIFT;
+  unsigned long long bottom = (last_row + 1) >> REGION_TILE_SHIFT;
+  unsigned long long left = (first_col + REGION_TILE - 1) >> REGION_TILE_SHIFT;
+  unsigned long long right = (last_col + 1) >> REGION_TILE_SHIFT;
+  bool whole_tiles = top < bottom && left < right;
+  if (whole_tiles)
+  {
+    sumRegionTiles(regions, bottom, right, sums, false);
+    sumRegionTiles(regions, top, right, sums, true);
+    sumRegionTiles(regions, bottom, left, sums, true);
+    sumRegionTiles(regions, top, left, sums, false);
+  }
+
+  unsigned long long first_tile_row = first_row >> REGION_TILE_SHIFT;
+  unsigned long long last_tile_row = last_row >> REGION_TILE_SHIFT;
+  unsigned long long first_tile_col = first_col >> REGION_TILE_SHIFT;
+  unsigned long long last_tile_col = last_col >> REGION_TILE_SHIFT;
+  for (unsigned long long tile_row = first_tile_row; tile_row <= last_tile_row; tile_row++)
+  {
+    unsigned tile_top = tile_row == first_tile_row ? first_row & (REGION_TILE - 1) : 0;
+    unsigned tile_bottom = tile_row == last_tile_row ? last_row & (REGION_TILE - 1) : REGION_TILE - 1;
+    bool inner_row = whole_tiles && tile_row >= top && tile_row < bottom;
+    for (unsigned long long tile_col = first_tile_col; tile_col <= last_tile_col; tile_col++)
+    {
+      if (inner_row && tile_col == left)
+      {
+        // the whole tiles of the row were summed up by the tree
+        tile_col = right - 1;
+        continue;
+      }
+      unsigned tile_left = tile_col == first_tile_col ? first_col & (REGION_TILE - 1) : 0;
+      unsigned tile_right = tile_col == last_tile_col ? last_col & (REGION_TILE - 1) : REGION_TILE - 1;
+      size_t tile = tile_row * regions->tile_columns + tile_col;
+      if (tile_left == 0 && tile_right == REGION_TILE - 1)
+      {
+        sumTileLines(regions, tile, 0, tile_top, tile_bottom, sums);
+      }
+      else if (tile_top == 0 && tile_bottom == REGION_TILE - 1)
+      {
+        sumTileLines(regions, tile, 1, tile_left, tile_right, sums);
+      }
+      else
+      {
+        unsigned long long tile_first_row = tile_row << REGION_TILE_SHIFT;
+        unsigned long long tile_first_col = tile_col << REGION_TILE_SHIFT;
+        countRegionFields(board, tile_first_row + tile_top, tile_first_col + tile_left, tile_first_row + tile_bottom,
+                          tile_first_col + tile_right, sums);
+      }
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Computes how many fields the storage of a board of a specified size takes in the layout the game was built with.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param num_fields Pointer to store the number of fields.
+/// @return Returns 0 on success or 1 if the storage would not fit into memory.
+//---------------------------------------------------------------------------------------------------------------------
+int countBoardFields(unsigned long long height, unsigned long long width, size_t *num_fields)
+{
+#if defined(A4_TILED_BOARD) || defined(A4_TIERED_BOARD)
+  // whole tiles are allocated, the fields past the edges of the board stay unused
+  unsigned long long rows = height / BOARD_TILE + (height % BOARD_TILE != 0);
+  unsigned long long tile_columns = width / BOARD_TILE + (width % BOARD_TILE != 0);
+  if (tile_columns > SIZE_MAX / (BOARD_TILE * BOARD_TILE))
+  {
+    return 1;
+  }
+  unsigned long long columns = tile_columns * BOARD_TILE * BOARD_TILE;
+#else
+  unsigned long long rows = height;
+  unsigned long long columns = width;
+#endif
+  if (columns != 0 && rows > SIZE_MAX / sizeof(myField) / columns)
+  {
+    return 1;
+  }
+  *num_fields = rows * columns;
+  return 0;
+}
+
+#ifdef A4_TIERED_BOARD
+//---------------------------------------------------------------------------------------------------------------------
+/// Prepares a tile of the tiered layout for a change of one of its fields: a cold tile is promoted to a hot tile
+/// holding the fields of its masks, with the mines of a procedural game taken from its hash, and the tile is listed as
+/// touched so settleBoardTiles checks it. If the hot tile cannot be allocated, the board is marked as failed and the
+/// change goes to its spare field.
+/// @param board A myBoard structure representing the game board.
+/// @param tile The index of the tile.
+/// @param offset The index of the field in the tile.
+/// @return A pointer to the field.
+//---------------------------------------------------------------------------------------------------------------------
+myField *touchBoardTile(myBoard *board, size_t tile, unsigned offset)
+{
+  myBoardTiers *tiers = &board->tiers;
+  myBoardTile *cold = claimBoardTile(board, tile);
+  if (cold != NULL && cold->hot != NULL && cold->hot->touched)
+  {
+    return &cold->hot->fields[offset];
+  }
+  myHotTile *hot = cold != NULL && cold->hot == NULL ? malloc(sizeof(myHotTile)) : NULL;
+  if (cold == NULL || (cold->hot == NULL && hot == NULL))
+  {
+    tiers->failed = true;
+    tiers->spare = (myField){false, false, 0, false};
+    return &tiers->spare;
+  }
+  if (cold->hot == NULL)
+  {
+    unsigned long long tile_row = tile / board->tile_columns * BOARD_TILE;
+    unsigned long long tile_col = tile % board->tile_columns * BOARD_TILE;
+    for (unsigned field = 0; field < BOARD_TILE * BOARD_TILE; field++)
+    {
+      unsigned long long row = tile_row + (field >> BOARD_TILE_SHIFT);
+      unsigned long long col = tile_col + (field & (BOARD_TILE - 1));
+      bool is_bomb = !board->procedural.enabled ? (cold->mines >> field & 1) != 0
+                     : row < board->height && col < board->width && isProceduralMine(&board->procedural, row, col);
+      hot->fields[field] = (myField){is_bomb, (cold->opened >> field & 1) != 0, 0, false};
+    }
+    hot->touched = false;
+    cold->hot = hot;
+    STATS_ADD(board_bytes, sizeof(myHotTile));
+    STATS_PEAK(board_bytes, board_peak_bytes);
+  }
+  // a tile missing from the list is only never demoted, it still works
+  if (reserveArray((void **)&tiers->touched, &tiers->touched_capacity, tiers->num_touched + 1, sizeof(size_t)) == 0)
+  {
+    tiers->touched[tiers->num_touched++] = tile;
+    cold->hot->touched = true;
+  }
+  return &cold->hot->fields[offset];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns a tile of the tiered layout to be changed. A procedural board adds a cold tile without opened fields the
+/// first time one of its fields is played.
+/// @param board A myBoard structure representing the game board.
+/// @param tile The index of the tile.
+/// @return A pointer to the tile, valid until the next tile is added, or NULL if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+myBoardTile *claimBoardTile(myBoard *board, size_t tile)
+{
+  myBoardTiers *tiers = &board->tiers;
+  myBoardTile *found = findBoardTile(board, tile);
+  if (found != NULL)
+  {
+    return found;
+  }
+  size_t played_capacity = tiers->played_capacity;
+  size_t directory_capacity = tiers->directory.capacity;
+  if (reserveArray((void **)&tiers->played, &tiers->played_capacity, tiers->num_played + 1, sizeof(myBoardTile)) != 0 ||
+      insertIndexMap(&tiers->directory, tile, tiers->num_played) != 0)
+  {
+    return NULL;
+  }
+  size_t slot_size = sizeof(unsigned long long) + sizeof(size_t);
+  STATS_ADD(board_bytes, (tiers->played_capacity - played_capacity) * sizeof(myBoardTile) +
+                             (tiers->directory.capacity - directory_capacity) * slot_size);
+  STATS_PEAK(board_bytes, board_peak_bytes);
+  tiers->played[tiers->num_played] = (myBoardTile){0, 0, NULL};
+  // the fields of the tile are counted from now on, none of them is opened yet
+  board->counters.closed_safe += refreshProceduralTile(board, tile, &tiers->played[tiers->num_played]);
+  return &tiers->played[tiers->num_played++];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns a copy of a field of a procedural game in the tiered layout, see readBoardField.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row of the field.
+/// @param col The column of the field.
+/// @return The field.
+//---------------------------------------------------------------------------------------------------------------------
+myField readProceduralField(const myBoard *board, unsigned long long row, unsigned long long col)
+{
+  unsigned long long offset = (row & (BOARD_TILE - 1)) << BOARD_TILE_SHIFT | (col & (BOARD_TILE - 1));
+  const myBoardTile *tile =
+      findBoardTile(board, (row >> BOARD_TILE_SHIFT) * board->tile_columns + (col >> BOARD_TILE_SHIFT));
+  if (tile != NULL && tile->hot != NULL)
+  {
+    return tile->hot->fields[offset];
+  }
+  bool is_opened = tile != NULL && (tile->opened >> offset & 1) != 0;
+  return (myField){isProceduralMine(&board->procedural, row, col), is_opened, 0, false};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Demotes the hot tiles of the tiered layout which were touched since the last call and are completely opened or
+/// completely closed again, without flags, back to cold tiles. Called once a command is done, when no pointer to a
+/// field is kept any more.
+/// @param board A myBoard structure representing the game board.
+/// @return Returns 0 on success or 1 if a tile could not be promoted since the last call.
+//---------------------------------------------------------------------------------------------------------------------
+int settleBoardTiles(myBoard *board)
+{
+  myBoardTiers *tiers = &board->tiers;
+  for (size_t n = 0; n < tiers->num_touched; n++)
+  {
+    size_t tile = tiers->touched[n];
+    myBoardTile *entry = findBoardTile(board, tile);
+    myHotTile *hot = entry->hot;
+    hot->touched = false;
+    unsigned long long tile_row = tile / board->tile_columns * BOARD_TILE;
+    unsigned long long tile_col = tile % board->tile_columns * BOARD_TILE;
+    unsigned rows = board->height - tile_row < BOARD_TILE ? board->height - tile_row : BOARD_TILE;
+    unsigned cols = board->width - tile_col < BOARD_TILE ? board->width - tile_col : BOARD_TILE;
+    uint64_t mines = 0;
+    uint64_t opened = 0;
+    bool flagged = false;
+    bool closed_safe = false;
+    bool any_opened = false;
+    for (unsigned row = 0; row < rows; row++)
+    {
+      for (unsigned col = 0; col < cols; col++)
+      {
+        unsigned offset = row << BOARD_TILE_SHIFT | col;
+        const myField *field = &hot->fields[offset];
+        mines |= (uint64_t)field->is_bomb << offset;
+        opened |= (uint64_t)field->is_opened << offset;
+        flagged |= field->is_flagged;
+        closed_safe |= !field->is_opened & !field->is_bomb;
+        any_opened |= field->is_opened;
+      }
+    }
+    if (!flagged && (!closed_safe || !any_opened))
+    {
+      *entry = (myBoardTile){mines, opened, NULL};
+      free(hot);
+      STATS_ADD(board_bytes, -sizeof(myHotTile));
+    }
+  }
+  tiers->num_touched = 0;
+  bool failed = tiers->failed;
+  tiers->failed = false;
+  return failed ? 1 : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the hot tiles of the tiered layout, leaving all tiles cold.
+/// @param board A myBoard structure representing the game board.
+//---------------------------------------------------------------------------------------------------------------------
+void releaseHotTiles(myBoard *board)
+{
+  myBoardTiers *tiers = &board->tiers;
+  myBoardTile *tiles = tiers->tiles != NULL ? tiers->tiles : tiers->played;
+  size_t num_tiles = tiers->tiles != NULL ? board->num_fields / (BOARD_TILE * BOARD_TILE) : tiers->num_played;
+  for (size_t tile = 0; tile < num_tiles; tile++)
+  {
+    if (tiles[tile].hot != NULL)
+    {
+      free(tiles[tile].hot);
+      tiles[tile].hot = NULL;
+      STATS_ADD(board_bytes, -sizeof(myHotTile));
+    }
+  }
+  tiers->num_touched = 0;
+  tiers->failed = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the tiles a procedural board played in the tiered layout, after their hot tiles were released.
+/// @param board A myBoard structure representing the game board.
+//---------------------------------------------------------------------------------------------------------------------
+void releasePlayedTiles(myBoard *board)
+{
+  myBoardTiers *tiers = &board->tiers;
+  STATS_ADD(board_bytes, -(tiers->played_capacity * sizeof(myBoardTile) +
+                           tiers->directory.capacity * (sizeof(unsigned long long) + sizeof(size_t))));
+  free(tiers->played);
+  tiers->played = NULL;
+  tiers->num_played = 0;
+  tiers->played_capacity = 0;
+  freeIndexMap(&tiers->directory);
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Changes the size of a game board and clears all its fields. The memory of the fields is reused whenever it is large
+/// enough; otherwise it is released before the larger one is allocated, so a board never holds more than one
+/// allocation besides the hot tiles of the tiered layout, which are all released together with the tiles a procedural
+/// board played. A procedural board of the tiered layout allocates no tiles here.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The new height of the game board.
+/// @param width The new width of the game board.
+/// @return Returns 0 on success or 1 if memory allocation fails, which leaves the board without fields.
+//---------------------------------------------------------------------------------------------------------------------
+int resizeMemoryBoard(myBoard *board, unsigned long long height, unsigned long long width)
+{
+  size_t num_fields = 0;
+  int too_large = countBoardFields(height, width, &num_fields);
+  invalidateRegionIndex(board);
+#ifdef A4_TIERED_BOARD
+  releaseHotTiles(board);
+  releasePlayedTiles(board);
+  void **storage = (void **)&board->tiers.tiles;
+  size_t num_units = num_fields / (BOARD_TILE * BOARD_TILE);
+  if (board->procedural.enabled && !too_large)
+  {
+    // the tiles of a procedural board are added as they are played, see claimBoardTile
+    free(*storage);
+    *storage = NULL;
+    STATS_ADD(board_bytes, -(board->capacity * BOARD_UNIT_SIZE));
+    board->capacity = 0;
+  }
+  else
+#else
+  void **storage = (void **)&board->fields;
+  size_t num_units = num_fields;
+#endif
+  if (too_large || *storage == NULL || num_units > board->capacity)
+  {
+    free(*storage);
+    STATS_ADD(board_bytes, -(board->capacity * BOARD_UNIT_SIZE));
+    board->capacity = 0;
+    *storage = too_large ? NULL : calloc(num_units > 0 ? num_units : 1, BOARD_UNIT_SIZE);
+    if (*storage == NULL)
+    {
+      board->height = 0;
+      board->width = 0;
+      board->num_fields = 0;
+      board->counters = (myBoardCounters){0, 0, 0, 0};
+      return 1;
+    }
+    board->capacity = num_units;
+    STATS_ADD(board_allocations, 1);
+    STATS_ADD(board_bytes, num_units * BOARD_UNIT_SIZE);
+    STATS_PEAK(board_bytes, board_peak_bytes);
+  }
+  else
+  {
+    memset(*storage, 0, num_units * BOARD_UNIT_SIZE);
+    STATS_ADD(board_reuses, 1);
+  }
+  board->height = height;
+  board->width = width;
+  board->tile_columns = width / BOARD_TILE + (width % BOARD_TILE != 0);
+  board->num_fields = num_fields;
+  board->counters = (myBoardCounters){0, 0, 0, height * width};
+#ifdef A4_TIERED_BOARD
+  if (board->tiers.tiles == NULL)
+  {
+    // the closed fields of a procedural board are counted as its tiles are played
+    board->counters.closed_safe = 0;
+    board->procedural.safe_tile = 0;
+  }
+#endif
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Allocates memory for a game board of a specified size and initializes each field.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param procedural Whether the board is played by a procedural game, which does not store its mines.
+/// @return Returns a pointer to the allocated game board or NULL if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+myBoard *allocateMemoryBoard(unsigned long long height, unsigned long long width, bool procedural)
+{
+  myBoard *board = calloc(1, sizeof(myBoard));
+  if (board != NULL)
+  {
+    board->procedural.enabled = procedural;
+  }
+  if (board == NULL || resizeMemoryBoard(board, height, width) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    free(board);
+    return NULL;
+  }
+  return board;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Releases the memory of a game board.
+/// @param board A pointer to the game board, a myBoard structure.
+//---------------------------------------------------------------------------------------------------------------------
+void releaseMemoryBoard(myBoard *board)
+{
+  STATS_ADD(board_bytes, -(board->capacity * BOARD_UNIT_SIZE));
+  freeRegionIndex(board->regions);
+#ifdef A4_TIERED_BOARD
+  releaseHotTiles(board);
+  releasePlayedTiles(board);
+  free(board->tiers.tiles);
+  free(board->tiers.touched);
+#endif
+  free(board->fields);
+  free(board);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the allocated memory for the game board, or returns the board to its pool.
+/// @param board A pointer to the game board, a myBoard structure.
+//---------------------------------------------------------------------------------------------------------------------
+void freeMemoryBoard(myBoard *board)
+{
+  myBoardPool *pool = board->pool;
+  if (pool != NULL && pool->num_boards < BOARD_POOL_SIZE)
+  {
+    pool->boards[pool->num_boards++] = board;
+    return;
+  }
+  releaseMemoryBoard(board);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Takes a board from a pool, preferring one of the given size, and resizes it, clearing all its fields, or allocates
+/// a new one if the pool has none. The board returns to the pool when it is freed.
+/// @param pool The pool of boards.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param procedural Whether the board is played by a procedural game, which does not store its mines.
+/// @return Returns a pointer to the game board or NULL if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+myBoard *acquireMemoryBoard(myBoardPool *pool, unsigned long long height, unsigned long long width, bool procedural)
+{
+  if (pool->num_boards == 0)
+  {
+    myBoard *board = allocateMemoryBoard(height, width, procedural);
+    if (board != NULL)
+    {
+      board->pool = pool;
+    }
+    return board;
+  }
+  size_t chosen = pool->num_boards - 1;
+  for (size_t b = 0; b < pool->num_boards; b++)
+  {
+    if (pool->boards[b]->height == height && pool->boards[b]->width == width)
+    {
+      chosen = b;
+      break;
+    }
+  }
+  myBoard *board = pool->boards[chosen];
+  pool->boards[chosen] = pool->boards[--pool->num_boards];
+  board->history = NULL;
+  board->procedural.enabled = procedural;
+  if (resizeMemoryBoard(board, height, width) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    releaseMemoryBoard(board);
+    return NULL;
+  }
+  return board;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees all boards of a pool.
+/// @param pool The pool of boards.
+//---------------------------------------------------------------------------------------------------------------------
+void freeBoardPool(myBoardPool *pool)
+{
+  for (size_t b = 0; b < pool->num_boards; b++)
+  {
+    releaseMemoryBoard(pool->boards[b]);
+  }
+  pool->num_boards = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Generates a 64-bit random number by combining the results of two calls to rand().
+/// This function shifts the result of the first rand() call to the upper 32 bits and combines it with the result of
+/// a second rand() call to fill the lower 32 bits, creating a 64-bit random number.
+/// @return A 64-bit random number.
+//---------------------------------------------------------------------------------------------------------------------
+long long generate64BitRandomNumber()
+{
+  STATS_ADD(random_numbers, 1);
+  long long upper_bits = rand();
+  long long lower_bits = rand();
+
+  upper_bits = upper_bits << 32;
+
+  long long fullNumber = upper_bits | lower_bits;
+
+  return fullNumber;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Seeds a random number generator which is private to its owner. It produces the same numbers as rand() of the GNU C
+/// library after srand() with the same seed, so a seeded game can be reproduced on any thread.
+/// @param random The generator to seed.
+/// @param seed The seed value.
+//---------------------------------------------------------------------------------------------------------------------
+void seedRandom(myRandom *random, unsigned int seed)
+{
+  random->table[0] = seed == 0 ? 1 : seed;
+  for (int i = 1; i < 31; i++)
+  {
+    long long word = (16807LL * (int32_t)random->table[i - 1]) % 2147483647;
+    random->table[i] = (uint32_t)(word < 0 ? word + 2147483647 : word);
+  }
+  for (int i = 31; i < 34; i++)
+  {
+    random->table[i] = random->table[i - 31];
+  }
+  random->index = 34;
+  for (int i = 0; i < 310; i++)
+  {
+    nextRandom(random);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the next number of a private random number generator, between 0 and 2^31 - 1 like rand().
+/// @param random The generator.
+/// @return The next random number.
+//---------------------------------------------------------------------------------------------------------------------
+int nextRandom(myRandom *random)
+{
+  uint32_t value = random->table[(random->index + 3) % 34] + random->table[(random->index + 31) % 34];
+  random->table[random->index % 34] = value;
+  random->index = (random->index + 1) % 34;
+  return (int)(value >> 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Generates a 64-bit random number like generate64BitRandomNumber(), but from a private generator if one is given.
+/// @param random The generator to use, or NULL for rand().
+/// @return A 64-bit random number.
+//---------------------------------------------------------------------------------------------------------------------
+long long generateRandomNumberFrom(myRandom *random)
+{
+  if (random == NULL)
+  {
+    return generate64BitRandomNumber();
+  }
+  STATS_ADD(random_numbers, 1);
+  long long upper_bits = nextRandom(random);
+  long long lower_bits = nextRandom(random);
+  return upper_bits << 32 | lower_bits;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Draws the next numbers of a random number generator at once, the same numbers as calling nextRandom() or rand() for
+/// each of them. A private generator runs its recurrence over a window of the last 34 numbers and the new ones, so the
+/// table is only indexed when the window is copied in and out.
+/// @param random The generator to draw from, or NULL for rand().
+/// @param numbers The array the numbers are stored in.
+/// @param count The number of numbers to draw, at most 2 * RANDOM_BATCH.
+//---------------------------------------------------------------------------------------------------------------------
+void drawRandomNumbers(myRandom *random, uint32_t *numbers, size_t count)
+{
+  if (random == NULL)
+  {
+    for (size_t n = 0; n < count; n++)
+    {
+      numbers[n] = (uint32_t)rand();
+    }
+    return;
+  }
+  uint32_t window[34 + 2 * RANDOM_BATCH];
+  for (int n = 0; n < 34; n++)
+  {
+    window[n] = random->table[(random->index + n) % 34];
+  }
+  for (size_t n = 34; n < 34 + count; n++)
+  {
+    window[n] = window[n - 31] + window[n - 3];
+    numbers[n - 34] = window[n] >> 1;
+  }
+  memcpy(random->table, window + count, sizeof(random->table));
+  random->index = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the remainder of a random number divided by the number of fields left. The quotient estimated with the
+/// reciprocal of the divisor is off by at most one for numbers below 2^63 and divisors from RANDOM_SMALL_DIVISOR on,
+/// which the remainder is corrected for; smaller divisors are divided.
+/// @param number The random number.
+/// @param divisor The divisor.
+/// @param reciprocal The reciprocal of the divisor.
+/// @return The remainder, the same as number % divisor.
+//---------------------------------------------------------------------------------------------------------------------
+static inline unsigned long long reduceRandomNumber(unsigned long long number, unsigned long long divisor,
+                                                    double reciprocal)
+{
+  if (divisor < RANDOM_SMALL_DIVISOR)
+  {
+    return number % divisor;
+  }
+  unsigned long long quotient = (unsigned long long)((double)number * reciprocal);
+  long long remainder = (long long)(number - quotient * divisor);
+  remainder += remainder < 0 ? (long long)divisor : 0;
+  remainder -= remainder >= (long long)divisor ? (long long)divisor : 0;
+  return (unsigned long long)remainder;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Places the mines on the board with the numbers of the random number generator, except for the starting field.
+/// Every other field takes a 64-bit number made of two numbers of the generator, and becomes a mine if the number
+/// modulo the fields left is below the mines left. The numbers are drawn in batches and a field is set without
+/// branching on whether it is a mine, so the layout is the same as drawing and comparing the numbers one by one.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The total number of mines to place on the board.
+/// @param starting_field The index of the starting field, which will not contain a mine.
+/// @param random The random number generator to draw from, or NULL for rand().
+//---------------------------------------------------------------------------------------------------------------------
+void placeMines(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long count,
+                unsigned long long starting_field, myRandom *random)
+{
+  unsigned long long fields_left = height * width - 1;
+  unsigned long long mines_left = count;
+  unsigned long long closed_safe = 0;
+  uint32_t numbers[2 * RANDOM_BATCH];
+  size_t next = 0;
+  size_t drawn = 0;
+  invalidateRegionIndex(board);
+  STATS_ADD(random_numbers, fields_left);
+
+  for (unsigned long long row = 0; row < height; row++)
+  {
+    for (unsigned long long col = 0; col < width; col++)
+    {
+      bool is_opened = readBoardField(board, row, col).is_opened;
+      if (row * width + col == starting_field)
+      {
+        setBoardMine(board, row, col, false);
+        closed_safe += !is_opened;
+        continue;
+      }
+
+      if (next == drawn)
+      {
+        drawn = fields_left < RANDOM_BATCH ? 2 * fields_left : 2 * RANDOM_BATCH;
+        drawRandomNumbers(random, numbers, drawn);
+        next = 0;
+      }
+      unsigned long long random_number = (unsigned long long)numbers[next] << 32 | numbers[next + 1];
+      next += 2;
+      bool is_bomb = reduceRandomNumber(random_number, fields_left, 1.0 / (double)fields_left) < mines_left;
+      setBoardMine(board, row, col, is_bomb);
+      mines_left -= is_bomb;
+      closed_safe += !is_bomb & !is_opened;
+      fields_left = fields_left - 1;
+    }
+  }
+  board->counters.mines = count - mines_left;
+  board->counters.closed_safe = closed_safe;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Generates the game map by randomly placing mines on the board, except for the starting field. The numbers come from
+/// a private generator seeded like srand(), so the map is the same as with rand() without locking it for every number.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The total number of mines to place on the board.
+/// @param starting_field The index of the starting field, which will not contain a mine.
+/// @param seed A pointer to the seed value used for random number generation; if zero, the current time is used.
+//---------------------------------------------------------------------------------------------------------------------
+void generateMap(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long count,
+                 unsigned long long starting_field, int *seed)
+{
+  myRandom random;
+  if (seed != 0)
+  {
+    seedRandom(&random, *seed);
+  }
+  else
+  {
+    seedRandom(&random, time(NULL));
+  }
+
+  placeMines(board, height, width, count, starting_field, &random);
+}
+
+#ifdef A4_TIERED_BOARD
+//---------------------------------------------------------------------------------------------------------------------
+/// Takes the mines of a tile of the tiered layout from the hash of a procedural game: the fields of a hot tile are
+/// changed, a cold tile is left as it is since its mines are never read.
+/// @param board A myBoard structure representing the game board.
+/// @param tile The index of the tile.
+/// @param entry The tile.
+/// @return The closed fields of the tile which do not hide a mine.
+//---------------------------------------------------------------------------------------------------------------------
+unsigned long long refreshProceduralTile(myBoard *board, size_t tile, myBoardTile *entry)
+{
+  unsigned long long tile_row = tile / board->tile_columns * BOARD_TILE;
+  unsigned long long tile_col = tile % board->tile_columns * BOARD_TILE;
+  unsigned long long closed_safe = 0;
+  for (unsigned field = 0; field < BOARD_TILE * BOARD_TILE; field++)
+  {
+    unsigned long long row = tile_row + (field >> BOARD_TILE_SHIFT);
+    unsigned long long col = tile_col + (field & (BOARD_TILE - 1));
+    if (row >= board->height || col >= board->width)
+    {
+      continue;
+    }
+    bool is_bomb = isProceduralMine(&board->procedural, row, col);
+    if (entry->hot != NULL)
+    {
+      entry->hot->fields[field].is_bomb = is_bomb;
+      closed_safe += !entry->hot->fields[field].is_opened & !is_bomb;
+    }
+    else
+    {
+      closed_safe += !(entry->opened >> field & 1) & !is_bomb;
+    }
+  }
+  return closed_safe;
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Generates the game map of a procedural game: a field hides a mine if a hash of the seed and its position is below a
+/// threshold chosen so the expected number of mines is the one given, and the starting field and its neighbours never
+/// do. The tiered layout evaluates the hash whenever a field is read, the other layouts store the mines of all fields.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The number of mines the board is expected to have.
+/// @param starting_field The index of the starting field, which will not contain a mine and has no adjacent ones.
+/// @param seed A pointer to the seed value the hash is derived from.
+//---------------------------------------------------------------------------------------------------------------------
+void generateProceduralMap(myBoard *board, unsigned long long height, unsigned long long width,
+                           unsigned long long count, unsigned long long starting_field, int *seed)
+{
+  myProcedural *procedural = &board->procedural;
+  unsigned long long start_row = starting_field / width;
+  unsigned long long start_col = starting_field % width;
+  // the safe fields around the starting field do not count towards the density
+  unsigned long long safe_rows =
+      (start_row + 2 < height ? start_row + 2 : height) - (start_row > 0 ? start_row - 1 : 0);
+  unsigned long long safe_cols = (start_col + 2 < width ? start_col + 2 : width) - (start_col > 0 ? start_col - 1 : 0);
+  unsigned long long fields_left = height * width - safe_rows * safe_cols;
+  long double density = fields_left > 0 ? (long double)count / (long double)fields_left : 0;
+  procedural->enabled = true;
+  long double threshold = density * 18446744073709551616.0L;
+  procedural->key = mixBits((uint64_t)*seed ^ 0x9e3779b97f4a7c15ULL);
+  procedural->threshold = threshold >= 18446744073709551615.0L ? UINT64_MAX : (uint64_t)threshold;
+  procedural->start_row = start_row;
+  procedural->start_col = start_col;
+  invalidateRegionIndex(board);
+
+  unsigned long long mines = 0;
+  unsigned long long closed_safe = 0;
+#ifdef A4_TIERED_BOARD
+  myBoardTiers *tiers = &board->tiers;
+  if (tiers->tiles != NULL)
+  {
+    for (size_t tile = 0; tile < board->num_fields / (BOARD_TILE * BOARD_TILE); tile++)
+    {
+      closed_safe += refreshProceduralTile(board, tile, &tiers->tiles[tile]);
+    }
+  }
+  for (size_t slot = 0; slot < tiers->directory.capacity; slot++)
+  {
+    if (tiers->directory.values[slot] != SIZE_MAX)
+    {
+      closed_safe +=
+          refreshProceduralTile(board, tiers->directory.keys[slot], &tiers->played[tiers->directory.values[slot]]);
+    }
+  }
+  procedural->safe_tile = 0;
+  mines = count;
+  if (height * width <= PROCEDURAL_COUNT_FIELDS)
+  {
+    mines = 0;
+    for (unsigned long long row = 0; row < height; row++)
+    {
+      for (unsigned long long col = 0; col < width; col++)
+      {
+        mines += isProceduralMine(procedural, row, col);
+      }
+    }
+  }
+#else
+  for (unsigned long long row = 0; row < height; row++)
+  {
+    for (unsigned long long col = 0; col < width; col++)
+    {
+      bool is_bomb = isProceduralMine(procedural, row, col);
+      setBoardMine(board, row, col, is_bomb);
+      mines += is_bomb;
+      closed_safe += !readBoardField(board, row, col).is_opened & !is_bomb;
+    }
+  }
+#endif
+  board->counters.mines = mines;
+  board->counters.closed_safe = closed_safe;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the buffers of a solver.
+/// @param solver The solver to free.
+//---------------------------------------------------------------------------------------------------------------------
+void freeSolver(mySolver *solver)
+{
+  free(solver->state);
+  free(solver->number);
+  free(solver->queued);
+  free(solver->work);
+  free(solver->cascade);
+  free(solver->candidates);
+  free(solver->unknown);
+  free(solver->unknown_position);
+  memset(solver, 0, sizeof(mySolver));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Resets a solver to a board where nothing is known yet. The buffers are only allocated again if the board size
+/// changed, so repeated attempts on the same board reuse them.
+/// @param solver The solver to reset.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param mines The number of mines on the board.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int initSolver(mySolver *solver, unsigned long long height, unsigned long long width, unsigned long long mines)
+{
+  unsigned long long num_fields = height * width;
+  if (solver->num_fields != num_fields || solver->state == NULL)
+  {
+    myRandom *random = solver->random;
+    freeSolver(solver);
+    solver->random = random;
+    solver->state = malloc(num_fields * sizeof(uint8_t));
+    solver->number = malloc(num_fields * sizeof(uint8_t));
+    solver->queued = malloc(num_fields * sizeof(bool));
+    solver->work = malloc(num_fields * sizeof(size_t));
+    solver->cascade = malloc(num_fields * sizeof(size_t));
+    solver->candidates = malloc(num_fields * sizeof(size_t));
+    solver->unknown = malloc(num_fields * sizeof(size_t));
+    solver->unknown_position = malloc(num_fields * sizeof(size_t));
+    solver->num_fields = num_fields;
+    if (solver->state == NULL || solver->number == NULL || solver->queued == NULL || solver->work == NULL ||
+        solver->cascade == NULL || solver->candidates == NULL || solver->unknown == NULL ||
+        solver->unknown_position == NULL)
+    {
+      freeSolver(solver);
+      return 1;
+    }
+  }
+  solver->height = height;
+  solver->width = width;
+  solver->mines = mines;
+  solver->opened = 0;
+  solver->known_mines = 0;
+  solver->moves = 0;
+  solver->work_size = 0;
+  solver->cascade_size = 0;
+  solver->num_candidates = 0;
+  solver->num_unknown = num_fields;
+  memset(solver->state, SOLVER_UNKNOWN, num_fields * sizeof(uint8_t));
+  memset(solver->queued, 0, num_fields * sizeof(bool));
+  for (size_t field = 0; field < num_fields; field++)
+  {
+    solver->unknown[field] = field;
+    solver->unknown_position[field] = field;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Collects the neighbours of a field.
+/// @param solver The solver holding the board size.
+/// @param field The index of the field (row * width + col).
+/// @param neighbours Receives the indices of the up to 8 neighbours.
+/// @return The number of neighbours.
+//---------------------------------------------------------------------------------------------------------------------
+int neighboursOfField(const mySolver *solver, size_t field, size_t neighbours[8])
+{
+  unsigned long long row = field / solver->width;
+  unsigned long long col = field % solver->width;
+  int count = 0;
+  for (int x = -1; x <= 1; x++)
+  {
+    for (int y = -1; y <= 1; y++)
+    {
+      unsigned long long new_row = row + x;
+      unsigned long long new_col = col + y;
+      if ((x != 0 || y != 0) && new_row < solver->height && new_col < solver->width)
+      {
+        neighbours[count++] = new_row * solver->width + new_col;
+      }
+    }
+  }
+  return count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Removes a field from the list of unknown fields once the solver knows what it is.
+/// @param solver The solver.
+/// @param field The index of the field.
+//---------------------------------------------------------------------------------------------------------------------
+void forgetUnknownField(mySolver *solver, size_t field)
+{
+  size_t position = solver->unknown_position[field];
+  size_t last = solver->unknown[--solver->num_unknown];
+  solver->unknown[position] = last;
+  solver->unknown_position[last] = position;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Queues the opened neighbours of a field, whose deductions may have changed.
+/// @param solver The solver.
+/// @param field The index of the field.
+//---------------------------------------------------------------------------------------------------------------------
+void queueOpenedNeighbours(mySolver *solver, size_t field)
+{
+  size_t neighbours[8];
+  int count = neighboursOfField(solver, field, neighbours);
+  for (int n = 0; n < count; n++)
+  {
+    if (solver->state[neighbours[n]] == SOLVER_OPENED && !solver->queued[neighbours[n]])
+    {
+      solver->queued[neighbours[n]] = true;
+      solver->work[solver->work_size++] = neighbours[n];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Opens a field the solver knows to be safe, and all fields around opened fields without adjacent mines.
+/// @param solver The solver.
+/// @param board A myBoard structure holding the mines.
+/// @param field The index of the safe field.
+//---------------------------------------------------------------------------------------------------------------------
+void openSolverField(mySolver *solver, myBoard *board, size_t field)
+{
+  solver->moves++;
+  solver->state[field] = SOLVER_OPENED;
+  forgetUnknownField(solver, field);
+  solver->cascade[solver->cascade_size++] = field;
+  while (solver->cascade_size > 0)
+  {
+    size_t current = solver->cascade[--solver->cascade_size];
+    size_t neighbours[8];
+    int count = neighboursOfField(solver, current, neighbours);
+    int adjacent_mines = 0;
+    for (int n = 0; n < count; n++)
+    {
+      adjacent_mines += readBoardField(board, neighbours[n] / solver->width, neighbours[n] % solver->width).is_bomb;
+    }
+    solver->number[current] = adjacent_mines;
+    solver->opened++;
+    queueOpenedNeighbours(solver, current);
+    if (!solver->queued[current])
+    {
+      solver->queued[current] = true;
+      solver->work[solver->work_size++] = current;
+    }
+    if (adjacent_mines > 0)
+    {
+      solver->candidates[solver->num_candidates++] = current;
+      continue;
+    }
+    for (int n = 0; n < count; n++)
+    {
+      if (solver->state[neighbours[n]] == SOLVER_UNKNOWN)
+      {
+        solver->state[neighbours[n]] = SOLVER_OPENED;
+        forgetUnknownField(solver, neighbours[n]);
+        solver->cascade[solver->cascade_size++] = neighbours[n];
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Marks a field the solver knows to be a mine.
+/// @param solver The solver.
+/// @param field The index of the mine.
+//---------------------------------------------------------------------------------------------------------------------
+void markSolverMine(mySolver *solver, size_t field)
+{
+  solver->state[field] = SOLVER_MINE;
+  solver->known_mines++;
+  forgetUnknownField(solver, field);
+  queueOpenedNeighbours(solver, field);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Collects the unknown neighbours of an opened field and the number of mines still hidden among them.
+/// @param solver The solver.
+/// @param field The index of the opened field.
+/// @param unknown Receives the indices of the unknown neighbours.
+/// @param num_unknown Receives the number of unknown neighbours.
+/// @return The number of mines among the unknown neighbours.
+//---------------------------------------------------------------------------------------------------------------------
+int unknownNeighbours(const mySolver *solver, size_t field, size_t unknown[8], int *num_unknown)
+{
+  size_t neighbours[8];
+  int count = neighboursOfField(solver, field, neighbours);
+  int missing = solver->number[field];
+  *num_unknown = 0;
+  for (int n = 0; n < count; n++)
+  {
+    if (solver->state[neighbours[n]] == SOLVER_UNKNOWN)
+    {
+      unknown[(*num_unknown)++] = neighbours[n];
+    }
+    else if (solver->state[neighbours[n]] == SOLVER_MINE)
+    {
+      missing--;
+    }
+  }
+  return missing;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Applies the deduction rules to an opened field: all of its unknown neighbours are safe or mines, or, compared with
+/// an opened field nearby, the neighbours only one of the two has are all safe or all mines.
+/// @param solver The solver.
+/// @param board A myBoard structure holding the mines.
+/// @param field The index of the opened field.
+//---------------------------------------------------------------------------------------------------------------------
+void checkSolverField(mySolver *solver, myBoard *board, size_t field)
+{
+  size_t unknown[8];
+  int num_unknown;
+  int missing = unknownNeighbours(solver, field, unknown, &num_unknown);
+  if (num_unknown == 0)
+  {
+    return;
+  }
+  if (missing == 0 || missing == num_unknown)
+  {
+    for (int n = 0; n < num_unknown; n++)
+    {
+      if (solver->state[unknown[n]] != SOLVER_UNKNOWN)
+      {
+        continue;
+      }
+      if (missing == 0)
+      {
+        openSolverField(solver, board, unknown[n]);
+      }
+      else
+      {
+        markSolverMine(solver, unknown[n]);
+      }
+    }
+    return;
+  }
+
+  unsigned long long row = field / solver->width;
+  unsigned long long col = field % solver->width;
+  for (int x = -2; x <= 2; x++)
+  {
+    for (int y = -2; y <= 2; y++)
+    {
+      unsigned long long other_row = row + x;
+      unsigned long long other_col = col + y;
+      size_t other = other_row * solver->width + other_col;
+      if ((x == 0 && y == 0) || other_row >= solver->height || other_col >= solver->width ||
+          solver->state[other] != SOLVER_OPENED)
+      {
+        continue;
+      }
+      size_t other_unknown[8];
+      int other_num_unknown;
+      int other_missing = unknownNeighbours(solver, other, other_unknown, &other_num_unknown);
+
+      // only_here: unknown neighbours of this field only, only_there: of the other field only
+      size_t only_here[8];
+      size_t only_there[8];
+      int num_here = 0;
+      int num_there = 0;
+      for (int n = 0; n < num_unknown; n++)
+      {
+        bool shared = false;
+        for (int m = 0; m < other_num_unknown && !shared; m++)
+        {
+          shared = unknown[n] == other_unknown[m];
+        }
+        if (!shared)
+        {
+          only_here[num_here++] = unknown[n];
+        }
+      }
+      if (num_here == num_unknown)
+      {
+        continue;
+      }
+      for (int m = 0; m < other_num_unknown; m++)
+      {
+        bool shared = false;
+        for (int n = 0; n < num_unknown && !shared; n++)
+        {
+          shared = other_unknown[m] == unknown[n];
+        }
+        if (!shared)
+        {
+          only_there[num_there++] = other_unknown[m];
+        }
+      }
+      if (num_here + num_there == 0)
+      {
+        continue;
+      }
+
+      size_t *safe = NULL;
+      size_t *mines = NULL;
+      int num_safe = 0;
+      int num_mines = 0;
+      if (other_missing - missing == num_there)
+      {
+        safe = only_here;
+        num_safe = num_here;
+        mines = only_there;
+        num_mines = num_there;
+      }
+      else if (missing - other_missing == num_here)
+      {
+        safe = only_there;
+        num_safe = num_there;
+        mines = only_here;
+        num_mines = num_here;
+      }
+      else
+      {
+        continue;
+      }
+      for (int n = 0; n < num_mines; n++)
+      {
+        markSolverMine(solver, mines[n]);
+      }
+      for (int n = 0; n < num_safe; n++)
+      {
+        if (solver->state[safe[n]] == SOLVER_UNKNOWN)
+        {
+          openSolverField(solver, board, safe[n]);
+        }
+      }
+      return;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Solves the board as far as possible without guessing.
+/// @param solver The solver, with at least one opened field.
+/// @param board A myBoard structure holding the mines.
+/// @return Returns true if all safe fields are opened.
+//---------------------------------------------------------------------------------------------------------------------
+bool runSolver(mySolver *solver, myBoard *board)
+{
+  while (true)
+  {
+    while (solver->work_size > 0)
+    {
+      size_t field = solver->work[--solver->work_size];
+      solver->queued[field] = false;
+      checkSolverField(solver, board, field);
+    }
+
+    // once every mine is known, the rest of the board is safe
+    if (solver->known_mines < solver->mines || solver->num_unknown == 0)
+    {
+      break;
+    }
+    while (solver->num_unknown > 0)
+    {
+      openSolverField(solver, board, solver->unknown[0]);
+    }
+  }
+  return solver->opened + solver->mines == solver->num_fields;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Picks a random unknown field with or without a mine, preferring fields next to no opened field, where moving the
+/// mine changes nothing the solver has seen.
+/// @param solver The solver.
+/// @param board A myBoard structure holding the mines.
+/// @param mine Whether the field must hide a mine.
+/// @param avoid An opened field whose neighbours must not be picked.
+/// @return The index of the field, or SIZE_MAX if none was found.
+//---------------------------------------------------------------------------------------------------------------------
+size_t pickUnknownField(const mySolver *solver, myBoard *board, bool mine, size_t avoid)
+{
+  size_t fallback = SIZE_MAX;
+  unsigned long long avoid_row = avoid / solver->width;
+  unsigned long long avoid_col = avoid % solver->width;
+  for (int draw = 0; draw < NO_GUESS_TARGET_DRAWS && solver->num_unknown > 0; draw++)
+  {
+    size_t field = solver->unknown[generateRandomNumberFrom(solver->random) % solver->num_unknown];
+    unsigned long long row = field / solver->width;
+    unsigned long long col = field % solver->width;
+    if (readBoardField(board, row, col).is_bomb != mine || (row + 1 - avoid_row <= 2 && col + 1 - avoid_col <= 2))
+    {
+      continue;
+    }
+    size_t neighbours[8];
+    int count = neighboursOfField(solver, field, neighbours);
+    bool interior = true;
+    for (int n = 0; n < count && interior; n++)
+    {
+      interior = solver->state[neighbours[n]] != SOLVER_OPENED;
+    }
+    if (interior)
+    {
+      return field;
+    }
+    fallback = fallback == SIZE_MAX ? field : fallback;
+  }
+  return fallback;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Moves a mine from one unknown field to another and updates the numbers of the opened fields around both.
+/// @param solver The solver.
+/// @param board A myBoard structure holding the mines.
+/// @param from The field hiding the mine.
+/// @param to The field without a mine.
+//---------------------------------------------------------------------------------------------------------------------
+void moveSolverMine(mySolver *solver, myBoard *board, size_t from, size_t to)
+{
+  size_t fields[2] = {from, to};
+  for (int side = 0; side < 2; side++)
+  {
+    unsigned long long row = fields[side] / solver->width;
+    unsigned long long col = fields[side] % solver->width;
+    setBoardMine(board, row, col, side == 1);
+    board->counters.closed_safe += readBoardField(board, row, col).is_opened ? 0 : (side == 1 ? -1 : 1);
+    size_t neighbours[8];
+    int count = neighboursOfField(solver, fields[side], neighbours);
+    for (int n = 0; n < count; n++)
+    {
+      if (solver->state[neighbours[n]] == SOLVER_OPENED)
+      {
+        solver->number[neighbours[n]] += side == 1 ? 1 : -1;
+      }
+    }
+    queueOpenedNeighbours(solver, fields[side]);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Changes the board where the solver is stuck: all unknown neighbours of a random opened field are cleared by moving
+/// their mines elsewhere, or, if that is not possible, filled with mines from elsewhere. Either way the field's number
+/// then tells what its neighbours are. Only unknown fields change, so everything the solver deduced stays valid.
+/// @param solver The solver.
+/// @param board A myBoard structure holding the mines.
+/// @return Returns 0 if the board was changed, or 1 if there is no field to change.
+//---------------------------------------------------------------------------------------------------------------------
+int perturbBoard(mySolver *solver, myBoard *board)
+{
+  size_t unknown[8];
+  int num_unknown = 0;
+  size_t field = SIZE_MAX;
+  while (solver->num_candidates > 0)
+  {
+    size_t index = generateRandomNumberFrom(solver->random) % solver->num_candidates;
+    field = solver->candidates[index];
+    unknownNeighbours(solver, field, unknown, &num_unknown);
+    if (num_unknown > 0)
+    {
+      break;
+    }
+    solver->candidates[index] = solver->candidates[--solver->num_candidates];
+  }
+  if (solver->num_candidates == 0)
+  {
+    return 1;
+  }
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    bool mine = pass == 0;
+    bool complete = true;
+    for (int n = 0; n < num_unknown; n++)
+    {
+      if (readBoardField(board, unknown[n] / solver->width, unknown[n] % solver->width).is_bomb != mine)
+      {
+        continue;
+      }
+      size_t target = pickUnknownField(solver, board, !mine, field);
+      if (target == SIZE_MAX)
+      {
+        complete = false;
+        break;
+      }
+      moveSolverMine(solver, board, mine ? unknown[n] : target, mine ? target : unknown[n]);
+    }
+    if (complete)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Places mines which can be solved from the starting field without guessing. Mine layouts are drawn like in
+/// generateMap; wherever the solver gets stuck, the board is changed a little and solving continues where it stopped.
+/// A layout which cannot be repaired is dropped for the next one. The finished board is solved once more from the
+/// start to verify it. All random numbers come from the solver's generator, so a seed always gives the same board.
+/// If no layout is verified within NO_GUESS_MAX_ATTEMPTS, the last one stays on the board.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The total number of mines to place on the board.
+/// @param starting_field The index of the starting field, which will not contain a mine.
+/// @param solver The solver to use; its buffers are kept for the next call.
+/// @return Returns 0 on success, 1 if memory allocation fails, or 2 if the board left may need a guess.
+//---------------------------------------------------------------------------------------------------------------------
+int placeNoGuessMines(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long count,
+                      unsigned long long starting_field,
+                      mySolver *solver)
+{
+  for (int attempt = 0; attempt < NO_GUESS_MAX_ATTEMPTS; attempt++)
+  {
+    placeMines(board, height, width, count, starting_field, solver->random);
+    if (initSolver(solver, height, width, count) != 0)
+    {
+      return 1;
+    }
+    openSolverField(solver, board, starting_field);
+    bool solved = runSolver(solver, board);
+    for (unsigned long long changes = 0; !solved && changes < solver->num_fields; changes++)
+    {
+      if (perturbBoard(solver, board) != 0)
+      {
+        break;
+      }
+      solved = runSolver(solver, board);
+    }
+    if (!solved)
+    {
+      continue;
+    }
+
+    if (initSolver(solver, height, width, count) != 0)
+    {
+      return 1;
+    }
+    openSolverField(solver, board, starting_field);
+    if (runSolver(solver, board))
+    {
+      return 0;
+    }
+  }
+  return 2;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Generates a map which can be solved from the starting field without guessing, see placeNoGuessMines.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The total number of mines to place on the board.
+/// @param starting_field The index of the starting field, which will not contain a mine.
+/// @param seed A pointer to the seed value used for random number generation; if zero, the current time is used.
+/// @return Returns 0 on success, 1 if memory allocation fails, or 2 if the map may need a guess.
+//---------------------------------------------------------------------------------------------------------------------
+int generateNoGuessMap(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long count,
+                       unsigned long long starting_field, int *seed)
+{
+  mySolver solver;
+  myRandom random;
+  memset(&solver, 0, sizeof(mySolver));
+  solver.random = &random;
+
+  if (seed != 0)
+  {
+    seedRandom(&random, *seed);
+  }
+  else
+  {
+    seedRandom(&random, time(NULL));
+  }
+
+  int result = placeNoGuessMines(board, height, width, count, starting_field, &solver);
+  freeSolver(&solver);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Picks the field the solver opens when it cannot deduce anything: the unknown field with the lowest mine estimate.
+/// A field next to opened fields is estimated by its most dangerous opened neighbour, any other field by the share of
+/// mines among all unknown fields.
+/// @param solver The solver.
+/// @return The index of the field to open.
+//---------------------------------------------------------------------------------------------------------------------
+size_t pickGuessField(const mySolver *solver)
+{
+  double density = (double)(solver->mines - solver->known_mines) / (double)solver->num_unknown;
+  double best_estimate = 2.0;
+  size_t best_field = solver->unknown[0];
+  for (size_t u = 0; u < solver->num_unknown; u++)
+  {
+    size_t field = solver->unknown[u];
+    size_t neighbours[8];
+    int count = neighboursOfField(solver, field, neighbours);
+    double estimate = -1.0;
+    for (int n = 0; n < count; n++)
+    {
+      if (solver->state[neighbours[n]] != SOLVER_OPENED)
+      {
+        continue;
+      }
+      size_t unknown[8];
+      int num_unknown;
+      int missing = unknownNeighbours(solver, neighbours[n], unknown, &num_unknown);
+      double local = (double)missing / (double)num_unknown;
+      estimate = local > estimate ? local : estimate;
+    }
+    estimate = estimate < 0.0 ? density : estimate;
+    if (estimate < best_estimate || (estimate == best_estimate && field < best_field))
+    {
+      best_estimate = estimate;
+      best_field = field;
+    }
+  }
+  return best_field;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Plays a game with the solver: it deduces what it can and guesses when it is stuck, until it has opened all safe
+/// fields or hits a mine.
+/// @param solver The solver; its buffers are kept for the next game.
+/// @param board A myBoard structure holding the mines.
+/// @param mines The number of mines on the board.
+/// @param starting_field The index of the first field to open, which does not hide a mine.
+/// @param guesses Receives the number of guesses.
+/// @return Returns 1 if the game was won, 0 if it was lost, or -1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int playSolverGame(mySolver *solver, myBoard *board, unsigned long long mines, size_t starting_field,
+                   unsigned long long *guesses)
+{
+  *guesses = 0;
+  if (initSolver(solver, solver->height, solver->width, mines) != 0)
+  {
+    return -1;
+  }
+  openSolverField(solver, board, starting_field);
+  while (!runSolver(solver, board))
+  {
+    size_t field = pickGuessField(solver);
+    (*guesses)++;
+    if (readBoardField(board, field / solver->width, field % solver->width).is_bomb)
+    {
+      solver->moves++;
+      return 0;
+    }
+    openSolverField(solver, board, field);
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Compares two game durations for qsort.
+/// @param first Pointer to the first duration.
+/// @param second Pointer to the second duration.
+/// @return Negative, zero or positive like strcmp.
+//---------------------------------------------------------------------------------------------------------------------
+int compareDurations(const void *first, const void *second)
+{
+  double a = *(const double *)first;
+  double b = *(const double *)second;
+  return (a > b) - (a < b);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Plays games of a simulation until none are left. Every worker keeps one board, one solver and one random number
+/// generator for all of its games; the next game is taken from a shared counter.
+/// @param argument The worker, a mySimWorker structure.
+/// @return Always NULL.
+//---------------------------------------------------------------------------------------------------------------------
+void *runSimulationWorker(void *argument)
+{
+  mySimWorker *worker = argument;
+  mySimulation *simulation = worker->simulation;
+  unsigned long long height = simulation->height;
+  unsigned long long width = simulation->width;
+  size_t starting_field = (height / 2) * width + width / 2;
+  myRandom random;
+  mySolver solver;
+  memset(&solver, 0, sizeof(mySolver));
+  solver.random = &random;
+  solver.height = height;
+  solver.width = width;
+
+  myBoard *board = allocateMemoryBoard(height, width, false);
+  if (board == NULL)
+  {
+    worker->failed = true;
+    return NULL;
+  }
+
+  while (true)
+  {
+    unsigned long long game = atomic_fetch_add(&simulation->next_game, 1);
+    if (game >= simulation->games)
+    {
+      break;
+    }
+    struct timespec begin;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    seedRandom(&random, simulation->first_seed + game);
+    if (simulation->no_guess)
+    {
+      // a map which may need a guess is played all the same, its guesses are counted
+      if (placeNoGuessMines(board, height, width, simulation->count, starting_field, &solver) == 1)
+      {
+        worker->failed = true;
+        break;
+      }
+    }
+    else
+    {
+      placeMines(board, height, width, simulation->count, starting_field, &random);
+    }
+    unsigned long long guesses;
+    int won = playSolverGame(&solver, board, simulation->count, starting_field, &guesses);
+    if (won < 0)
+    {
+      worker->failed = true;
+      break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    simulation->durations[game] = (end.tv_sec - begin.tv_sec) * 1e6 + (end.tv_nsec - begin.tv_nsec) / 1e3;
+    worker->played++;
+    worker->won += won;
+    worker->moves += solver.moves;
+    worker->guesses += guesses;
+  }
+
+  freeSolver(&solver);
+  freeMemoryBoard(board);
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Plays a number of games with consecutive seeds on a pool of threads and prints the win rate, the moves and guesses
+/// per game and percentiles of the time per game. Game n uses the seed seed + n and starts in the middle of the
+/// board, so it can be replayed with --seed and start.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The number of mines.
+/// @param seed The seed of the first game.
+/// @param no_guess Whether the maps must be solvable without guessing.
+/// @param games The number of games to play.
+/// @param threads The number of threads, or 0 for one per processor.
+/// @return Returns 0 on success or 1 if memory allocation or thread creation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int runSimulation(unsigned long long height, unsigned long long width, unsigned long long count, int seed, bool no_guess,
+                  int games,
+                  int threads)
+{
+  if (threads == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = processors > 0 ? (int)processors : 1;
+  }
+  threads = threads > games ? games : threads;
+
+  mySimulation simulation;
+  simulation.height = height;
+  simulation.width = width;
+  simulation.count = count;
+  simulation.first_seed = seed;
+  simulation.no_guess = no_guess;
+  simulation.games = games;
+  atomic_init(&simulation.next_game, 0);
+  simulation.durations = malloc(games * sizeof(double));
+  mySimWorker *workers = calloc(threads, sizeof(mySimWorker));
+  pthread_t *handles = malloc(threads * sizeof(pthread_t));
+  if (simulation.durations == NULL || workers == NULL || handles == NULL)
+  {
+    printf(OUT_OF_MEMORY);
+    free(simulation.durations);
+    free(workers);
+    free(handles);
+    return 1;
+  }
+
+  struct timespec begin;
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  int started = 0;
+  for (; started < threads; started++)
+  {
+    workers[started].simulation = &simulation;
+    if (pthread_create(&handles[started], NULL, runSimulationWorker, &workers[started]) != 0)
+    {
+      break;
+    }
+  }
+  mySimWorker total;
+  memset(&total, 0, sizeof(mySimWorker));
+  total.failed = started == 0;
+  for (int t = 0; t < started; t++)
+  {
+    pthread_join(handles[t], NULL);
+    total.played += workers[t].played;
+    total.won += workers[t].won;
+    total.moves += workers[t].moves;
+    total.guesses += workers[t].guesses;
+    total.failed = total.failed || workers[t].failed;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  int result = 0;
+  if (total.failed || total.played < (unsigned long long)games)
+  {
+    printf(OUT_OF_MEMORY);
+    result = 1;
+  }
+  else
+  {
+    double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    qsort(simulation.durations, games, sizeof(double), compareDurations);
+    printf("Simulated %d game%s (%llu x %llu, %llu mines, seeds %d-%lld) on %d thread%s in %.3f s.\n", games,
+           games == 1 ? "" : "s", height, width, count, seed, (long long)seed + games - 1, started,
+           started == 1 ? "" : "s", seconds);
+    printf("Won: %llu (%.2f%%)\n", total.won, 100.0 * total.won / games);
+    printf("Moves per game: %.2f\n", (double)total.moves / games);
+    printf("Guesses per game: %.2f\n", (double)total.guesses / games);
+    printf("Time per game (us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", simulation.durations[(games - 1) / 2],
+           simulation.durations[(games - 1) * 90 / 100], simulation.durations[(games - 1) * 99 / 100],
+           simulation.durations[games - 1]);
+  }
+  free(simulation.durations);
+  free(workers);
+  free(handles);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the number of bombs adjacent to a given field on the game board.
+/// @param board A myBoard structure representing the game board.
+/// @param i The row index of the field.
+/// @param j The column index of the field.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @return The number of adjacent bombs.
+//---------------------------------------------------------------------------------------------------------------------
+int countAdjacentBombs(myBoard *board, unsigned long long i, unsigned long long j, unsigned long long height,
+                       unsigned long long width)
+{
+  STATS_ADD(adjacent_counts, 1);
+  int adjacent_bombs = 0;
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled)
+  {
+    // the hash is evaluated without looking up the tiles
+    for (unsigned long long row = i > 0 ? i - 1 : 0; row <= i + 1 && row < height; row++)
+    {
+      for (unsigned long long col = j > 0 ? j - 1 : 0; col <= j + 1 && col < width; col++)
+      {
+        adjacent_bombs += isProceduralMine(&board->procedural, row, col);
+      }
+    }
+    return adjacent_bombs;
+  }
+#endif
+  for (unsigned long long row = i > 0 ? i - 1 : 0; row <= i + 1 && row < height; row++)
+  {
+    for (unsigned long long col = j > 0 ? j - 1 : 0; col <= j + 1 && col < width; col++)
+    {
+      adjacent_bombs += isBoardMine(board, row, col);
+    }
+  }
+  return adjacent_bombs;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Opens a single closed field which is not a bomb, removing its flag and counting its adjacent bombs.
+/// @param board A myBoard structure representing the game board.
+/// @param x The row index of the field to open.
+/// @param y The column index of the field to open.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @return The number of adjacent bombs of the field.
+//---------------------------------------------------------------------------------------------------------------------
+int openSafeField(myBoard *board, unsigned long long x, unsigned long long y, unsigned long long height,
+                  unsigned long long width, long long *remaining_flags)
+{
+  recordFieldChange(board, x, y, FIELD_CHANGED_OPENED | (boardField(board, x, y)->is_flagged ? FIELD_CHANGED_FLAGGED : 0));
+  if (boardField(board, x, y)->is_flagged)
+  {
+    boardField(board, x, y)->is_flagged = false;
+    (*remaining_flags)++;
+  }
+  int adjacent_bombs = countAdjacentBombs(board, x, y, height, width);
+  boardField(board, x, y)->is_opened = true;
+  boardField(board, x, y)->adjacent_bombs = adjacent_bombs;
+  return adjacent_bombs;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns one word of a row of a bit plane with the bits of the 3x3 neighbourhood of every field set, taking the rows
+/// above and below and the neighbouring words into account.
+/// @param above The row above.
+/// @param row The row.
+/// @param below The row below.
+/// @param word The index of the word in the row.
+/// @param words The number of words of a row.
+/// @return The word with every field set which has a set field in its neighbourhood.
+//---------------------------------------------------------------------------------------------------------------------
+static inline uint64_t spreadBits(const uint64_t *above, const uint64_t *row, const uint64_t *below, size_t word,
+                                  size_t words)
+{
+  uint64_t middle = above[word] | row[word] | below[word];
+  uint64_t lower = word > 0 ? above[word - 1] | row[word - 1] | below[word - 1] : 0;
+  uint64_t upper = word + 1 < words ? above[word + 1] | row[word + 1] | below[word + 1] : 0;
+  return middle | middle << 1 | lower >> 63 | middle >> 1 | upper << 63;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Extends the set bits of a row of a bit plane to the whole runs of set bits of the mask they lie in, first towards
+/// higher and then towards lower columns, with logarithmic shift steps inside a word and a carry between words.
+/// @param row The row, its set bits have to be set in the mask.
+/// @param mask The row of the mask.
+/// @param words The number of words of a row.
+//---------------------------------------------------------------------------------------------------------------------
+void fillRowBits(uint64_t *row, const uint64_t *mask, size_t words)
+{
+  uint64_t carry = 0;
+  for (size_t word = 0; word < words; word++)
+  {
+    uint64_t filled = row[word] | (carry & mask[word]);
+    uint64_t open = mask[word];
+    for (int shift = 1; shift < 64; shift <<= 1)
+    {
+      filled |= open & (filled << shift);
+      open &= open << shift;
+    }
+    row[word] = filled;
+    carry = filled >> 63;
+  }
+  carry = 0;
+  for (size_t word = words; word-- > 0;)
+  {
+    uint64_t filled = row[word] | (carry & mask[word]);
+    uint64_t open = mask[word];
+    for (int shift = 1; shift < 64; shift <<= 1)
+    {
+      filled |= open & (filled >> shift);
+      open &= open >> shift;
+    }
+    row[word] = filled;
+    carry = filled << 63;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Adds the fields of a row to the region which are closed, have no adjacent bombs and touch the region.
+/// @param region The region plane, the row is preceded and followed by a row.
+/// @param zero The plane of closed fields without adjacent bombs.
+/// @param words The number of words of a row.
+/// @return Returns true if fields were added.
+//---------------------------------------------------------------------------------------------------------------------
+bool growRegionRow(uint64_t *region, const uint64_t *zero, size_t words)
+{
+  uint64_t added = 0;
+  for (size_t word = 0; word < words; word++)
+  {
+    uint64_t grown = region[word] | (spreadBits(region - words, region, region + words, word, words) & zero[word]);
+    added |= grown ^ region[word];
+    region[word] = grown;
+  }
+  if (added == 0)
+  {
+    return false;
+  }
+  fillRowBits(region, zero, words);
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Opens the region of fields without adjacent bombs around an opened field without adjacent bombs together with its
+/// border, exactly the fields opening them one by one would open. The bombs and the closed fields of a window of the
+/// board are turned into bit planes, the region is grown word by word inside the closed fields without adjacent
+/// bombs until it stops changing and the fields next to it are opened. The window is enlarged and the region grown
+/// again while it reaches the edge of the window, so only the part of the board around the region is read.
+/// @param board A myBoard structure representing the game board.
+/// @param x The row index of the opened field.
+/// @param y The column index of the opened field.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @return Returns 0 if the fields were opened or 3 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int openZeroRegion(myBoard *board, unsigned long long x, unsigned long long y, unsigned long long height,
+                   unsigned long long width, long long *remaining_flags)
+{
+  unsigned long long board_words = width / 64 + (width % 64 != 0);
+  unsigned long long first_row = x > CASCADE_WINDOW_ROWS / 2 ? x - CASCADE_WINDOW_ROWS / 2 : 0;
+  unsigned long long last_row = height - x > CASCADE_WINDOW_ROWS / 2 ? x + CASCADE_WINDOW_ROWS / 2 + 1 : height;
+  unsigned long long first_word = y / 64 > CASCADE_WINDOW_WORDS / 2 ? y / 64 - CASCADE_WINDOW_WORDS / 2 : 0;
+  unsigned long long last_word = board_words - y / 64 > CASCADE_WINDOW_WORDS / 2 + 1
+                                     ? y / 64 + CASCADE_WINDOW_WORDS / 2 + 1
+                                     : board_words;
+
+  while (true)
+  {
+    size_t rows = last_row - first_row;
+    size_t words = last_word - first_word;
+    size_t plane_size = (rows + 2) * words; // every plane has an empty row above and below the window
+    uint64_t *planes = calloc(3 * plane_size, sizeof(uint64_t));
+    if (planes == NULL)
+    {
+      return 3;
+    }
+    uint64_t *closed = planes;
+    uint64_t *zero = planes + plane_size;
+    uint64_t *region = planes + 2 * plane_size; // holds the bombs until the zero plane is built
+
+    unsigned long long first_col = first_word * 64;
+    unsigned long long last_col = last_word * 64 < width ? last_word * 64 : width;
+    for (size_t row = 0; row < rows; row++)
+    {
+      for (unsigned long long col = first_col; col < last_col; col++)
+      {
+        myField field = readBoardField(board, first_row + row, col);
+        size_t word = (row + 1) * words + (col - first_col) / 64;
+        region[word] |= (uint64_t)field.is_bomb << ((col - first_col) % 64);
+        closed[word] |= (uint64_t)!field.is_opened << ((col - first_col) % 64);
+      }
+    }
+    // fields on the edge of the window may miss bombs outside of it, the region never stays there
+    for (size_t row = 1; row <= rows; row++)
+    {
+      uint64_t *bombs = region + row * words;
+      for (size_t word = 0; word < words; word++)
+      {
+        uint64_t near_bombs = spreadBits(bombs - words, bombs, bombs + words, word, words);
+        zero[row * words + word] = closed[row * words + word] & ~near_bombs;
+      }
+    }
+    // the opened field starts the region, it is neither closed nor in the zero plane
+    memset(region, 0, plane_size * sizeof(uint64_t));
+    region[(x - first_row + 1) * words + (y - first_col) / 64] = (uint64_t)1 << ((y - first_col) % 64);
+
+    bool changed = true;
+    while (changed)
+    {
+      changed = false;
+      for (size_t row = 1; row <= rows; row++)
+      {
+        changed |= growRegionRow(region + row * words, zero + row * words, words);
+      }
+      for (size_t row = rows; row >= 1; row--)
+      {
+        changed |= growRegionRow(region + row * words, zero + row * words, words);
+      }
+    }
+
+    bool grow_up = false;
+    bool grow_down = false;
+    bool grow_left = false;
+    bool grow_right = false;
+    for (size_t word = 0; word < words; word++)
+    {
+      grow_up |= first_row > 0 && region[words + word] != 0;
+      grow_down |= last_row < height && region[rows * words + word] != 0;
+    }
+    for (size_t row = 1; row <= rows; row++)
+    {
+      grow_left |= first_word > 0 && (region[row * words] & 1) != 0;
+      grow_right |= last_word < board_words && (region[row * words + words - 1] >> 63) != 0;
+    }
+    if (grow_up || grow_down || grow_left || grow_right)
+    {
+      free(planes);
+      first_row = grow_up ? (first_row > rows ? first_row - rows : 0) : first_row;
+      last_row = grow_down ? (height - last_row > rows ? last_row + rows : height) : last_row;
+      first_word = grow_left ? (first_word > words ? first_word - words : 0) : first_word;
+      last_word = grow_right ? (board_words - last_word > words ? last_word + words : board_words) : last_word;
+      continue;
+    }
+
+    unsigned long long opened = 0;
+    for (size_t row = 1; row <= rows; row++)
+    {
+      uint64_t *line = region + row * words;
+      for (size_t word = 0; word < words; word++)
+      {
+        uint64_t fields = spreadBits(line - words, line, line + words, word, words) & closed[row * words + word];
+        while (fields != 0)
+        {
+          int bit = __builtin_ctzll(fields);
+          unsigned long long i = first_row + row - 1;
+          unsigned long long j = first_col + word * 64 + bit;
+          myField field = readBoardField(board, i, j);
+          recordFieldChange(board, i, j, FIELD_CHANGED_OPENED | (field.is_flagged ? FIELD_CHANGED_FLAGGED : 0));
+          if (field.is_flagged)
+          {
+            field.is_flagged = false;
+            (*remaining_flags)++;
+          }
+          field.is_opened = true;
+          field.adjacent_bombs = (line[word] >> bit & 1) ? 0 : countAdjacentBombs(board, i, j, height, width);
+          writeBoardField(board, i, j, field); // a cold tile of the tiered layout stays cold
+          opened++;
+          fields &= fields - 1;
+        }
+      }
+    }
+    STATS_ADD(flood_fill_fields, opened);
+    free(planes);
+    return 0;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Opens a field on the game board. If the field is a bomb, the game ends. Otherwise, it reveals the number of adjacent bombs.
+/// If a field with no adjacent bombs is opened, adjacent fields are opened as well. The area of fields without
+/// adjacent bombs is opened at once by openZeroRegion, so it may be as large as the board.
+///
+/// @param board A myBoard structure representing the game board.
+/// @param x The row index of the field to open.
+/// @param y The column index of the field to open.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+///
+/// @return Returns 0 if the field was successfully opened, 1 if the coordinates are invalid, 2 if a bomb was opened,
+///         indicating the game is over, or 3 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int openField(myBoard *board, unsigned long long x, unsigned long long y, unsigned long long height,
+              unsigned long long width, long long *remaining_flags)
+{
+  STATS_ADD(flood_fill_fields, 1);
+  if (x >= height || y >= width)
+  {
+    printf(INVALID_COORDINATES);
+    return 1;
+  }
+
+  if (readBoardField(board, x, y).is_opened == true)
+  {
+    return 0;
+  }
+
+  if (readBoardField(board, x, y).is_bomb == true)
+  {
+    myField *field = boardField(board, x, y);
+    recordFieldChange(board, x, y, FIELD_CHANGED_OPENED | (field->is_flagged ? FIELD_CHANGED_FLAGGED : 0));
+    if (field->is_flagged)
+    {
+      field->is_flagged = false;
+      (*remaining_flags)++;
+    }
+    field->is_opened = true;
+    return 2;
+  }
+
+  if (openSafeField(board, x, y, height, width, remaining_flags) != 0)
+  {
+    return 0;
+  }
+  return openZeroRegion(board, x, y, height, width, remaining_flags);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the entire game map including the number of flags left, a horizontal border, and the current state of the game board.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param flags_left The number of flags left for the player to use.
+//---------------------------------------------------------------------------------------------------------------------
+void printMap(myBoard *board, unsigned long long height, unsigned long long width, long long flags_left)
+{
+  if (render_suppressed)
+  {
+    return;
+  }
+  printFlagsLeft(flags_left);
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_GAME, RENDER_ANSI, ULLONG_MAX, ULLONG_MAX},
+              stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the map with only opened fields visible, including the number of flags left and a horizontal border.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param flags_left The number of flags left for the player to use.
+//---------------------------------------------------------------------------------------------------------------------
+void printOpenedMap(myBoard *board, unsigned long long height, unsigned long long width, long long flags_left)
+{
+  if (render_suppressed)
+  {
+    return;
+  }
+  printFlagsLeft(flags_left);
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_OPENED, RENDER_ANSI, ULLONG_MAX, ULLONG_MAX},
+              stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the initial welcome message and game settings including field size and number of mines.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The number of mines to be placed on the game board.
+//---------------------------------------------------------------------------------------------------------------------
+void printInitialMessage(unsigned long long height, unsigned long long width, unsigned long long count)
+{
+  printf("Welcome to ESP Minesweeper!\n");
+  printf("Chosen field size: %llu x %llu.\n", height, width);
+  printf("After map generation %llu mines will be hidden in the playing field.\n", count);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Clears the input buffer to prevent unwanted characters from affecting subsequent inputs.
+//---------------------------------------------------------------------------------------------------------------------
+void clearInputBuffer()
+{
+  int c;
+  while ((c = getchar()) != '\n' && c != EOF)
+  {
+  }
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Toggles the flag status of a field on the game board, either adding or removing a flag based on its current state.
+/// @param board A myBoard structure representing the game board.
+/// @param i The row index of the field to toggle.
+/// @param j The column index of the field to toggle.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+//---------------------------------------------------------------------------------------------------------------------
+void fieldFlag(myBoard *board, unsigned long long i, unsigned long long j, long long *remaining_flags)
+{
+  if (readBoardField(board, i, j).is_flagged == true)
+  {
+    recordFieldChange(board, i, j, FIELD_CHANGED_FLAGGED);
+    boardField(board, i, j)->is_flagged = false;
+    (*remaining_flags)++;
+  }
+  else if (readBoardField(board, i, j).is_flagged == false && readBoardField(board, i, j).is_opened == false)
+  {
+    recordFieldChange(board, i, j, FIELD_CHANGED_FLAGGED);
+    boardField(board, i, j)->is_flagged = true;
+    (*remaining_flags)--;
+  }
+}
+
+#ifdef A4_TIERED_BOARD
+//---------------------------------------------------------------------------------------------------------------------
+/// Looks for a tile of a procedural board in the tiered layout which was not played and has a field without a mine.
+/// The search goes on from the tile it stopped at last time, since a tile stays played and its mines do not change.
+/// @param board A myBoard structure representing the game board.
+/// @return Returns true if there is such a tile.
+//---------------------------------------------------------------------------------------------------------------------
+bool findUnplayedSafeTile(myBoard *board)
+{
+  myProcedural *procedural = &board->procedural;
+  size_t tiles = board->num_fields / (BOARD_TILE * BOARD_TILE);
+  for (; procedural->safe_tile < tiles; procedural->safe_tile++)
+  {
+    myBoardTile unplayed = {0, 0, NULL};
+    if (findBoardTile(board, procedural->safe_tile) == NULL &&
+        refreshProceduralTile(board, procedural->safe_tile, &unplayed) != 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Checks if the win condition is met, all non-bomb fields being opened, from the counters of the board. A procedural
+/// board in the tiered layout only counts the played tiles, so the others are searched for a field without a mine.
+/// @param board A myBoard structure representing the game board.
+/// @return Returns 0 if the win condition is met, otherwise returns 1.
+//---------------------------------------------------------------------------------------------------------------------
+int checkWinCondition(myBoard *board)
+{
+  if (board->counters.closed_safe != 0)
+  {
+    return 1;
+  }
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled && board->tiers.tiles == NULL && findUnplayedSafeTile(board))
+  {
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Counts the bombs around a field from the padded bomb plane of a preset board.
+/// @param bombs The bomb plane, one word per row with an empty row above and below the board.
+/// @param row The row index of the field.
+/// @param col The column index of the field.
+/// @return The number of adjacent bombs.
+//---------------------------------------------------------------------------------------------------------------------
+static inline int countPresetBombs(const uint64_t *bombs, unsigned long long row, unsigned long long col)
+{
+  STATS_ADD(adjacent_counts, 1);
+  uint64_t window = (uint64_t)7 << col >> 1;
+  return __builtin_popcountll(bombs[row] & window) + __builtin_popcountll(bombs[row + 1] & window) +
+         __builtin_popcountll(bombs[row + 2] & window);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Opens a field of a board of a preset size, with the same effect as openField. The body is inlined into the engine
+/// of every preset, so the size is a constant there and every loop has a fixed bound. A cascade turns the whole board
+/// into bit planes of one word per row on the stack; no neighbour in them needs a bounds check, as the planes are
+/// padded by an empty row above and below and the bits past the last column stay cleared.
+/// @param board A myBoard structure representing the game board.
+/// @param x The row index of the field to open.
+/// @param y The column index of the field to open.
+/// @param height The height of the preset, at most PRESET_MAX_HEIGHT.
+/// @param width The width of the preset, at most 63.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @return Returns 0 if the field was successfully opened, 1 if the coordinates are invalid or 2 if a bomb was opened.
+//---------------------------------------------------------------------------------------------------------------------
+static inline __attribute__((always_inline)) int openPresetField(myBoard *board, unsigned long long x,
+                                                                 unsigned long long y, const unsigned long long height,
+                                                                 const unsigned long long width,
+                                                                 long long *remaining_flags)
+{
+  STATS_ADD(flood_fill_fields, 1);
+  if (x >= height || y >= width)
+  {
+    printf(INVALID_COORDINATES);
+    return 1;
+  }
+  if (PRESET_READ_FIELD(board, x, y, width).is_opened)
+  {
+    return 0;
+  }
+  myField *target = PRESET_FIELD(board, x, y, width);
+  recordFieldChange(board, x, y, FIELD_CHANGED_OPENED | (target->is_flagged ? FIELD_CHANGED_FLAGGED : 0));
+  if (target->is_flagged)
+  {
+    target->is_flagged = false;
+    (*remaining_flags)++;
+  }
+  target->is_opened = true;
+  if (target->is_bomb)
+  {
+    return 2;
+  }
+  STATS_ADD(adjacent_counts, 1);
+  int adjacent_bombs = 0;
+  for (unsigned long long row = x > 0 ? x - 1 : 0; row <= x + 1 && row < height; row++)
+  {
+    for (unsigned long long col = y > 0 ? y - 1 : 0; col <= y + 1 && col < width; col++)
+    {
+      adjacent_bombs += PRESET_READ_FIELD(board, row, col, width).is_bomb;
+    }
+  }
+  target->adjacent_bombs = adjacent_bombs;
+  if (adjacent_bombs != 0)
+  {
+    return 0;
+  }
+
+  // only a cascade needs the planes of the whole board
+  uint64_t bombs[PRESET_MAX_HEIGHT + 2] = {0};
+  uint64_t closed[PRESET_MAX_HEIGHT + 2] = {0};
+  for (unsigned long long row = 0; row < height; row++)
+  {
+    for (unsigned long long col = 0; col < width; col++)
+    {
+      myField field = PRESET_READ_FIELD(board, row, col, width);
+      bombs[row + 1] |= (uint64_t)field.is_bomb << col;
+      closed[row + 1] |= (uint64_t)!field.is_opened << col;
+    }
+  }
+  uint64_t zero[PRESET_MAX_HEIGHT + 2] = {0};
+  uint64_t region[PRESET_MAX_HEIGHT + 2] = {0};
+  for (unsigned long long row = 1; row <= height; row++)
+  {
+    zero[row] = closed[row] & ~spreadBits(bombs + row - 1, bombs + row, bombs + row + 1, 0, 1);
+  }
+  region[x + 1] = (uint64_t)1 << y;
+  bool grown = true;
+  while (grown)
+  {
+    grown = false;
+    for (unsigned long long row = 1; row <= height; row++)
+    {
+      grown |= growRegionRow(region + row, zero + row, 1);
+    }
+    for (unsigned long long row = height; row >= 1; row--)
+    {
+      grown |= growRegionRow(region + row, zero + row, 1);
+    }
+  }
+
+  unsigned long long opened = 0;
+  for (unsigned long long row = 1; row <= height; row++)
+  {
+    uint64_t fields = spreadBits(region + row - 1, region + row, region + row + 1, 0, 1) & closed[row];
+    while (fields != 0)
+    {
+      unsigned long long col = __builtin_ctzll(fields);
+      myField *field = PRESET_FIELD(board, row - 1, col, width);
+      recordFieldChange(board, row - 1, col, FIELD_CHANGED_OPENED | (field->is_flagged ? FIELD_CHANGED_FLAGGED : 0));
+      if (field->is_flagged)
+      {
+        field->is_flagged = false;
+        (*remaining_flags)++;
+      }
+      field->is_opened = true;
+      field->adjacent_bombs = (region[row] >> col & 1) ? 0 : countPresetBombs(bombs, row - 1, col);
+      opened++;
+      fields &= fields - 1;
+    }
+  }
+  STATS_ADD(flood_fill_fields, opened);
+  return 0;
+}
+
+// Defines the engine of a preset: openField##name with the size of the preset fixed.
+#define DEFINE_BOARD_ENGINE(name, height, width)                                                                     \
+  _Static_assert((height) <= PRESET_MAX_HEIGHT && (width) < 64, "preset board too large for the bit planes");         \
+  static int openField##name(myBoard *board, unsigned long long x, unsigned long long y, long long *remaining_flags) \
+  {                                                                                                                  \
+    return openPresetField(board, x, y, (height), (width), remaining_flags);                                         \
+  }
+
+DEFINE_BOARD_ENGINE(Beginner, 9, 9)
+DEFINE_BOARD_ENGINE(Intermediate, 16, 16)
+DEFINE_BOARD_ENGINE(Expert, 16, 30)
+
+static const myBoardEngine board_engines[] = {
+    {"beginner", 9, 9, openFieldBeginner},
+    {"intermediate", 16, 16, openFieldIntermediate},
+    {"expert", 16, 30, openFieldExpert},
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Looks up the engine specialized for a board size.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @return The engine of the preset with this size, or NULL if the size is no preset and the generic code is used.
+//---------------------------------------------------------------------------------------------------------------------
+const myBoardEngine *findBoardEngine(unsigned long long height, unsigned long long width)
+{
+  for (size_t engine = 0; engine < sizeof(board_engines) / sizeof(board_engines[0]); engine++)
+  {
+    if (board_engines[engine].height == height && board_engines[engine].width == width)
+    {
+      return &board_engines[engine];
+    }
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Prints the game board in a special format when the player wins, showing all bombs and opened fields.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param remaining_flags The number of flags left for the player to use.
+//---------------------------------------------------------------------------------------------------------------------
+void printWonMap(myBoard *board, unsigned long long height, unsigned long long width, long long remaining_flags)
+{
+  if (render_suppressed)
+  {
+    return;
+  }
+  printFlagsLeft(remaining_flags);
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_WON, RENDER_ANSI, ULLONG_MAX, ULLONG_MAX}, stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "start" command by initializing the game board, placing mines, and opening the starting field.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param count The total number of mines to place on the board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @param seed The seed value used for random number generation.
+/// @param no_guess Whether the map must be solvable without guessing.
+/// @param procedural Whether the mines follow from a hash of the seed instead, which ignores no_guess.
+/// @param engine The engine specialized for the size of the board, or NULL to use the generic code.
+/// @param words An array of strings containing the command arguments.
+/// @return Returns 0 if the game continues, 1 for invalid command usage, 2 if the player loses by opening a bomb, and 3
+///         if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int handleStartCommand(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long count,
+                       int i, long long *remaining_flags, int seed, bool no_guess, bool procedural,
+                       const myBoardEngine *engine, char **words)
+{
+  if (i < 3)
+  {
+    printf(COMMAND_MISSING_ARGUMENTS);
+    return 1;
+  }
+  else if (i > 3)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return 1;
+  }
+  else
+  {
+    unsigned long long x;
+    unsigned long long y;
+    int x_result = parseBoundedNumber(words[1], height, &x);
+    int y_result = parseBoundedNumber(words[2], width, &y);
+    if (x_result == 1 || y_result == 1)
+    {
+      printf(INVALID_ARGUMENTS);
+      return 1;
+    }
+
+    if (x_result != 0 || y_result != 0)
+    {
+      printf(INVALID_COORDINATES);
+      return 1;
+    }
+
+    *remaining_flags = count;
+    unsigned long long starting_field = x * width + y;
+
+    if (procedural)
+    {
+      generateProceduralMap(board, height, width, count, starting_field, &seed);
+    }
+    else if (!no_guess)
+    {
+      generateMap(board, height, width, count, starting_field, &seed);
+    }
+    else
+    {
+      int result = generateNoGuessMap(board, height, width, count, starting_field, &seed);
+      if (result == 1)
+      {
+        printf(OUT_OF_MEMORY);
+        freeMemoryBoard(board);
+        return 3;
+      }
+      if (result == 2)
+      {
+        printf(NO_GUESS_FAILED);
+      }
+    }
+
+    int flag_bombica = engine != NULL ? engine->open_field(board, x, y, remaining_flags)
+                                      : openField(board, x, y, height, width, remaining_flags);
+
+    if (flag_bombica == 3)
+    {
+      printf(OUT_OF_MEMORY);
+      freeMemoryBoard(board);
+      return 3;
+    }
+    if (flag_bombica != 0)
+    {
+      printf("=== You lost! ===\n");
+      printLostMap(board, x, y, height, width, *remaining_flags);
+      freeMemoryBoard(board);
+      return 2;
+    }
+
+    printMap(board, height, width, *remaining_flags);
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "open" command by opening a specified field on the game board. It checks for command validity, parses
+/// coordinates, and manages game state changes such as flag removal, bomb opening, win condition, and map printing.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @param engine The engine specialized for the size of the board, or NULL to use the generic code.
+/// @param words An array of strings containing the command arguments.
+/// @return Returns 1 for continued gameplay, 0 for game over, 1 for invalid command usage, and 3 if memory allocation
+///         fails.
+//---------------------------------------------------------------------------------------------------------------------
+int handleOpenCommand(myBoard *board, unsigned long long height, unsigned long long width, int i,
+                      long long *remaining_flags, const myBoardEngine *engine, char **words)
+{
+  if (i < 3)
+  {
+    printf(COMMAND_MISSING_ARGUMENTS);
+    return 1;
+  }
+  else if (i > 3)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return 1;
+  }
+  else
+  {
+    unsigned long long x;
+    unsigned long long y;
+    int x_result = parseBoundedNumber(words[1], height, &x);
+    int y_result = parseBoundedNumber(words[2], width, &y);
+    if (x_result == 1 || y_result == 1)
+    {
+      printf(INVALID_ARGUMENTS);
+      return 1;
+    }
+
+    if (x_result != 0 || y_result != 0)
+    {
+      printf(INVALID_COORDINATES);
+      return 1;
+    }
+
+    if (readBoardField(board, x, y).is_flagged)
+    {
+      if (!readBoardField(board, x, y).is_bomb)
+      {
+        (*remaining_flags)++;
+      }
+      recordFieldChange(board, x, y, FIELD_CHANGED_FLAGGED);
+      boardField(board, x, y)->is_flagged = false;
+    }
+
+    int bomb = engine != NULL ? engine->open_field(board, x, y, remaining_flags)
+                              : openField(board, x, y, height, width, remaining_flags);
+    if (bomb == 3)
+    {
+      printf(OUT_OF_MEMORY);
+      freeMemoryBoard(board);
+      return 3;
+    }
+    if (bomb != 0)
+    {
+      printf("=== You lost! ===\n\n");
+      printLostMap(board, x, y, height, width, *remaining_flags);
+      freeMemoryBoard(board);
+      return 0;
+    }
+
+    int win = checkWinCondition(board);
+    if (win == 0)
+    {
+      printf("=== You won! ===\n\n");
+      printWonMap(board, height, width, *remaining_flags);
+      freeMemoryBoard(board);
+      return 0;
+    }
+    printMap(board, height, width, *remaining_flags);
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "flag" command by toggling the flag status of a specified field on the game board. It validates the
+/// command arguments, checks for valid coordinates, and updates the game state accordingly.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @param words An array of strings containing the command arguments.
+//---------------------------------------------------------------------------------------------------------------------
+void handleFlagCommand(myBoard *board, unsigned long long height, unsigned long long width, int i,
+                       long long *remaining_flags, char **words)
+{
+  if (i < 3)
+  {
+    printf(COMMAND_MISSING_ARGUMENTS);
+    return;
+  }
+  else if (i > 3)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return;
+  }
+  else
+  {
+    unsigned long long row;
+    unsigned long long col;
+    int row_result = parseBoundedNumber(words[1], height, &row);
+    int col_result = parseBoundedNumber(words[2], width, &col);
+    if (row_result == 1 || col_result == 1)
+    {
+      printf(INVALID_ARGUMENTS);
+      return;
+    }
+
+    if (row_result != 0 || col_result != 0)
+    {
+      printf(INVALID_COORDINATES);
+      return;
+    }
+    fieldFlag(board, row, col, remaining_flags);
+    printMap(board, height, width, *remaining_flags);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Forgets all moves of the history, keeping its memory for the next game.
+/// @param history The history of the game.
+//---------------------------------------------------------------------------------------------------------------------
+void clearHistory(myHistory *history)
+{
+  history->num_runs = 0;
+  history->num_moves = 0;
+  history->undone = 0;
+  history->failed = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the memory of the history.
+/// @param history The history of the game.
+//---------------------------------------------------------------------------------------------------------------------
+void freeHistory(myHistory *history)
+{
+  free(history->runs);
+  free(history->moves);
+  memset(history, 0, sizeof(myHistory));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Starts recording a move. Its runs are appended after those of all moves, including the ones which were undone.
+/// @param history The history of the game.
+//---------------------------------------------------------------------------------------------------------------------
+void beginMove(myHistory *history)
+{
+  history->failed = reserveArray((void **)&history->moves, &history->moves_capacity, history->num_moves + 1,
+                                 sizeof(myMove)) != 0;
+  if (!history->failed)
+  {
+    history->moves[history->num_moves].first_run = history->num_runs;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Finishes recording a move. A move which changed no field is dropped. Otherwise the moves which were undone can no
+/// longer be redone and the runs of the move take their place. If memory allocation failed while recording, the move
+/// cannot be undone and the whole history is forgotten.
+/// @param history The history of the game.
+/// @param flags_delta The change of the remaining flags by the move.
+//---------------------------------------------------------------------------------------------------------------------
+void endMove(myHistory *history, long long flags_delta)
+{
+  if (history->failed)
+  {
+    clearHistory(history);
+    return;
+  }
+  size_t first_run = history->moves[history->num_moves].first_run;
+  size_t num_runs = history->num_runs - first_run;
+  if (num_runs == 0)
+  {
+    return;
+  }
+  if (history->undone > 0)
+  {
+    history->num_moves -= history->undone;
+    history->undone = 0;
+    size_t kept_runs = 0;
+    if (history->num_moves > 0)
+    {
+      myMove *last = &history->moves[history->num_moves - 1];
+      kept_runs = last->first_run + last->num_runs;
+    }
+    memmove(history->runs + kept_runs, history->runs + first_run, num_runs * sizeof(myDeltaRun));
+    first_run = kept_runs;
+  }
+  history->moves[history->num_moves++] = (myMove){first_run, num_runs, flags_delta};
+  history->num_runs = first_run + num_runs;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Toggles the bits of all fields a move changed, which undoes the move or applies it again.
+/// @param board A myBoard structure representing the game board.
+/// @param history The history of the game.
+/// @param move The move.
+//---------------------------------------------------------------------------------------------------------------------
+void toggleMove(myBoard *board, const myHistory *history, const myMove *move)
+{
+  for (size_t r = move->first_run; r < move->first_run + move->num_runs; r++)
+  {
+    const myDeltaRun *run = &history->runs[r];
+    unsigned long long row = run->first / board->width;
+    unsigned long long col = run->first % board->width;
+    for (unsigned long long k = 0; k < run->length; k++)
+    {
+      myField *field = boardField(board, row, col);
+      countFieldChange(board, field, run->changed);
+      markRegionTile(board, row, col);
+      field->is_opened ^= (run->changed & FIELD_CHANGED_OPENED) != 0;
+      field->is_flagged ^= (run->changed & FIELD_CHANGED_FLAGGED) != 0;
+      if (++col == board->width)
+      {
+        col = 0;
+        row++;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes the board with every field opened followed by the board of the running game, each after the number of flags
+/// left, in one of the encodings. The boards are streamed through a buffer of RENDER_BUFFER_SIZE bytes, so memory use
+/// does not grow with the board and a slow reader blocks the writes instead of the output piling up.
+/// @param output The stream the boards are written to.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param flags_left The number of flags left for the player to use.
+/// @param encoding The RENDER_ encoding of the output.
+//---------------------------------------------------------------------------------------------------------------------
+void dumpBoard(FILE *output, myBoard *board, unsigned long long height, unsigned long long width, long long flags_left,
+               int encoding)
+{
+  const char *flag = encoding == RENDER_COMPACT ? "" : render_encoded_glyphs[encoding][RENDER_GLYPH_FLAG];
+  const char *space = encoding == RENDER_COMPACT ? "" : EMPTY_SPACE EMPTY_SPACE;
+  const char *separator = encoding == RENDER_COMPACT ? "" : ": ";
+  STATS_ADD(bytes_rendered, fprintf(output, "%s%s%s%lld\n", space, flag, separator, flags_left));
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_OPENED, encoding, ULLONG_MAX, ULLONG_MAX}, output);
+  STATS_ADD(bytes_rendered, fprintf(output, "\n%s%s%s%lld\n", space, flag, separator, flags_left));
+  renderBoard(&(myRenderFrame){board, height, width, RENDER_VIEW_GAME, encoding, ULLONG_MAX, ULLONG_MAX}, output);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "dump" command. Without arguments both boards are printed as before; "dump <filename> [encoding]"
+/// writes them to a file instead, or to the standard output for the filename "-", in the encoding "ansi", "plain" or
+/// "compact".
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags The number of flags left for the player to use.
+/// @param words The words of the command.
+//---------------------------------------------------------------------------------------------------------------------
+void handleDumpCommand(myBoard *board, unsigned long long height, unsigned long long width, int i,
+                       long long remaining_flags, char *words[])
+{
+  if (i == 1)
+  {
+    printOpenedMap(board, height, width, remaining_flags);
+    printf("\n");
+    printMap(board, height, width, remaining_flags);
+    return;
+  }
+  if (i > 3)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return;
+  }
+  static const char *const encoding_names[RENDER_ENCODINGS] = {"ansi", "plain", "compact"};
+  int encoding = i == 3 ? -1 : RENDER_ANSI;
+  for (int name = 0; name < RENDER_ENCODINGS && encoding < 0; name++)
+  {
+    encoding = strcmp(words[2], encoding_names[name]) == 0 ? name : -1;
+  }
+  if (encoding < 0)
+  {
+    printf(INVALID_ARGUMENTS);
+    return;
+  }
+  if (strcmp(words[1], "-") == 0)
+  {
+    if (!render_suppressed)
+    {
+      dumpBoard(stdout, board, height, width, remaining_flags, encoding);
+    }
+    return;
+  }
+  FILE *file_pointer = fopen(words[1], "w");
+  if (file_pointer == NULL)
+  {
+    printf(FAILED_TO_OPEN_FILE);
+    return;
+  }
+  dumpBoard(file_pointer, board, height, width, remaining_flags, encoding);
+  fclose(file_pointer);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes the board as a binary PPM image, or as a PGM image if the filename ends in ".pgm". Every pixel stands for
+/// a square of tile x tile fields and gets the mean color of its fields: closed fields are dark, mines red, opened
+/// fields white and flags yellow, so large tiles give a heatmap of the game. The image is built one row of pixels at a
+/// time from the board, so memory grows with the width of the image only.
+/// @param filename The name of the image file.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param tile The number of fields per side of the square a pixel stands for, at most EXPORT_MAX_TILE.
+/// @return Returns 0 if the image was written, 1 if the file could not be written, or 2 if memory ran out.
+//---------------------------------------------------------------------------------------------------------------------
+int exportBoardImage(const char *filename, myBoard *board, unsigned long long height, unsigned long long width,
+                     unsigned long long tile)
+{
+  // colors indexed by bomb | opened << 1 | flagged << 2, a flag hiding what is below it; PGM uses the first channel
+  static const uint8_t palettes[2][8][3] = {
+      {{96}, {0}, {255}, {255}, {160}, {160}, {160}, {160}},
+      {{64, 64, 64}, {200, 0, 0}, {255, 255, 255}, {255, 255, 255}, {255, 200, 0}, {255, 200, 0}, {255, 200, 0},
+       {255, 200, 0}}};
+  size_t length = strlen(filename);
+  size_t channels = length >= 4 && strcmp(filename + length - 4, ".pgm") == 0 ? 1 : 3;
+  const uint8_t(*palette)[3] = palettes[channels == 3];
+  unsigned long long image_height = height / tile + (height % tile != 0);
+  unsigned long long image_width = width / tile + (width % tile != 0);
+  if (image_width > SIZE_MAX / 3 / sizeof(unsigned long long))
+  {
+    return 2;
+  }
+  uint8_t *pixels = malloc(image_width * channels);
+  unsigned long long *sums = calloc(image_width * 3, sizeof(unsigned long long));
+  if (pixels == NULL || sums == NULL)
+  {
+    free(pixels);
+    free(sums);
+    return 2;
+  }
+  FILE *file_pointer = fopen(filename, "wb");
+  if (file_pointer == NULL)
+  {
+    free(pixels);
+    free(sums);
+    return 1;
+  }
+
+  fprintf(file_pointer, "P%d\n%llu %llu\n255\n", channels == 1 ? 5 : 6, image_width, image_height);
+  for (unsigned long long first_row = 0; first_row < height; first_row += tile)
+  {
+    unsigned long long last_row = height - first_row > tile ? first_row + tile : height;
+    if (tile == 1)
+    {
+      for (unsigned long long col = 0; col < width; col++)
+      {
+        myField field = readBoardField(board, first_row, col);
+        memcpy(pixels + col * channels, palette[field.is_bomb | field.is_opened << 1 | field.is_flagged << 2],
+               channels);
+      }
+      fwrite(pixels, channels, image_width, file_pointer);
+      continue;
+    }
+    for (unsigned long long row = first_row; row < last_row; row++)
+    {
+      unsigned long long col = 0;
+      for (unsigned long long pixel = 0; pixel < image_width; pixel++)
+      {
+        unsigned long long last_col = width - col > tile ? col + tile : width;
+        unsigned long long red = 0;
+        unsigned long long green = 0;
+        unsigned long long blue = 0;
+        for (; col < last_col; col++)
+        {
+          myField field = readBoardField(board, row, col);
+          const uint8_t *color = palette[field.is_bomb | field.is_opened << 1 | field.is_flagged << 2];
+          red += color[0];
+          green += color[1];
+          blue += color[2];
+        }
+        sums[3 * pixel] += red;
+        sums[3 * pixel + 1] += green;
+        sums[3 * pixel + 2] += blue;
+      }
+    }
+    for (unsigned long long pixel = 0; pixel < image_width; pixel++)
+    {
+      unsigned long long first_col = pixel * tile;
+      unsigned long long fields = (last_row - first_row) * (width - first_col > tile ? tile : width - first_col);
+      for (size_t channel = 0; channel < channels; channel++)
+      {
+        pixels[pixel * channels + channel] = (uint8_t)(sums[3 * pixel + channel] / fields);
+      }
+      memset(&sums[3 * pixel], 0, 3 * sizeof(unsigned long long));
+    }
+    fwrite(pixels, channels, image_width, file_pointer);
+  }
+
+  free(pixels);
+  free(sums);
+  bool failed = ferror(file_pointer) != 0;
+  return fclose(file_pointer) != 0 || failed ? 1 : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "export" command, "export <filename> [tile]", by writing the board as an image.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param words The words of the command.
+//---------------------------------------------------------------------------------------------------------------------
+void handleExportCommand(myBoard *board, unsigned long long height, unsigned long long width, int i, char *words[])
+{
+  if (i < 2)
+  {
+    printf(COMMAND_MISSING_ARGUMENTS);
+    return;
+  }
+  if (i > 3)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return;
+  }
+  unsigned long long tile = 1;
+  if (i == 3 && (parseBoundedNumber(words[2], EXPORT_MAX_TILE + 1, &tile) != 0 || tile == 0))
+  {
+    printf(INVALID_ARGUMENTS);
+    return;
+  }
+  int result = exportBoardImage(words[1], board, height, width, tile);
+  if (result != 0)
+  {
+    printf(result == 2 ? OUT_OF_MEMORY : FAILED_TO_OPEN_FILE);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "region" command, "region <r0> <c0> <r1> <c1>", by printing how many fields, mines, opened and flagged
+/// fields the rectangle between two corners holds, the corners included. Procedural boards of the tiered layout only
+/// count rectangles of up to PROCEDURAL_REGION_FIELDS fields.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param words The words of the command.
+/// @return Returns 0 on success, 1 if the arguments are invalid, or 2 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int handleRegionCommand(myBoard *board, unsigned long long height, unsigned long long width, int i, char *words[])
+{
+  if (i < 5)
+  {
+    printf(COMMAND_MISSING_ARGUMENTS);
+    return 1;
+  }
+  if (i > 5)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return 1;
+  }
+  unsigned long long corners[4];
+  int results[4];
+  for (int word = 0; word < 4; word++)
+  {
+    results[word] = parseBoundedNumber(words[word + 1], word % 2 == 0 ? height : width, &corners[word]);
+    if (results[word] == 1)
+    {
+      printf(INVALID_ARGUMENTS);
+      return 1;
+    }
+  }
+  if (results[0] != 0 || results[1] != 0 || results[2] != 0 || results[3] != 0 || corners[0] > corners[2] ||
+      corners[1] > corners[3])
+  {
+    printf(INVALID_COORDINATES);
+    return 1;
+  }
+
+  unsigned long long sums[REGION_COUNTS];
+  int result = queryRegion(board, corners[0], corners[1], corners[2], corners[3], sums);
+  if (result == 2)
+  {
+    printf(REGION_TOO_LARGE);
+    return 1;
+  }
+  if (result != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    return 2;
+  }
+  unsigned long long fields = (corners[2] - corners[0] + 1) * (corners[3] - corners[1] + 1);
+  printf("Fields: %llu, mines: %llu, opened: %llu, flagged: %llu\n", fields, sums[REGION_MINES], sums[REGION_OPENED],
+         sums[REGION_FLAGGED]);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Handles the "undo" and "redo" commands by reverting the last move or applying the last reverted move again. Only
+/// the fields changed by the move are touched.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// @param history The history of the game.
+/// @param redo True for "redo", false for "undo".
+//---------------------------------------------------------------------------------------------------------------------
+void handleUndoCommand(myBoard *board, unsigned long long height, unsigned long long width, int i,
+                       long long *remaining_flags, myHistory *history, bool redo)
+{
+  if (i > 1)
+  {
+    printf(TOO_MANY_ARGUMENTS);
+    return;
+  }
+  if (redo ? history->undone == 0 : history->undone == history->num_moves)
+  {
+    printf(redo ? NOTHING_TO_REDO : NOTHING_TO_UNDO);
+    return;
+  }
+  if (!redo)
+  {
+    history->undone++;
+  }
+  myMove *move = &history->moves[history->num_moves - history->undone];
+  toggleMove(board, history, move);
+  *remaining_flags += redo ? move->flags_delta : -move->flags_delta;
+  if (redo)
+  {
+    history->undone--;
+  }
+  printMap(board, height, width, *remaining_flags);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Saves the current game state to a file, including the board dimensions and the status of each field.
+/// @param filename The name of the file where the game state will be saved.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+//---------------------------------------------------------------------------------------------------------------------
+void saveGameStateToFile(char *filename, myBoard *board, unsigned long long height, unsigned long long width)
+{
+  unsigned long long begin = STATS_NOW();
+  FILE *file_pointer = fopen(filename, "wb");
+  if (file_pointer == NULL)
+  {
+    printf(FAILED_TO_OPEN_FILE);
+    return;
+  }
+
+  fwrite(MAGIC_NUMBER, sizeof(char), 4, file_pointer);
+
+  uint64_t height64 = (uint64_t)height;
+  uint64_t width64 = (uint64_t)width;
+  fwrite(&height64, sizeof(height64), 1, file_pointer);
+  fwrite(&width64, sizeof(width64), 1, file_pointer);
+
+  unsigned long long total_fields = height * width;
+  unsigned long long num_blocks = (total_fields + 7) / 8;
+
+  myBlockField *blocks = (myBlockField *)calloc(num_blocks, sizeof(myBlockField));
+  if (blocks == NULL)
+  {
+    printf(OUT_OF_MEMORY);
+    fclose(file_pointer);
+    return;
+  }
+
+  for (unsigned long long i = 0; i < total_fields; i++)
+  {
+    unsigned long long block_index = i / 8;
+    unsigned long long bit_position = i % 8;
+
+    if (readBoardField(board, i / width, i % width).is_flagged)
+    {
+      blocks[block_index].flag_bits |= 1 << bit_position;
+    }
+    if (readBoardField(board, i / width, i % width).is_opened)
+    {
+      blocks[block_index].open_bits |= 1 << bit_position;
+    }
+    if (readBoardField(board, i / width, i % width).is_bomb)
+    {
+      blocks[block_index].mine_bits |= 1 << bit_position;
+    }
+    blocks[block_index].valid_bits |= 1 << bit_position;
+  }
+
+  fwrite(blocks, sizeof(myBlockField), num_blocks, file_pointer);
+
+  free(blocks);
+  fclose(file_pointer);
+  STATS_ADD(saved_bytes, 4 + 2 * sizeof(uint64_t) + num_blocks * sizeof(myBlockField));
+  STATS_ADD(save_ns, STATS_NOW() - begin);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Checks a chunk of blocks read from a save file. Every field on the board must have its valid bit set, the bits
+/// past the last field must all be cleared and no field may be opened and flagged at the same time.
+/// @param blocks The blocks of the chunk.
+/// @param count The number of blocks in the chunk.
+/// @param first_field The index of the first field of the chunk.
+/// @param total_fields The number of fields on the board.
+/// @return Returns 0 if the blocks are consistent or 1 otherwise.
+//---------------------------------------------------------------------------------------------------------------------
+int checkFieldBlocks(const myBlockField *blocks, size_t count, unsigned long long first_field,
+                     unsigned long long total_fields)
+{
+  for (size_t b = 0; b < count; b++, first_field += 8)
+  {
+    unsigned long long fields = total_fields - first_field;
+    uint8_t mask = fields >= 8 ? 0xff : (uint8_t)((1u << fields) - 1);
+    uint8_t used = blocks[b].valid_bits | blocks[b].mine_bits | blocks[b].open_bits | blocks[b].flag_bits;
+    if (blocks[b].valid_bits != mask || (used & ~mask) != 0 || (blocks[b].open_bits & blocks[b].flag_bits) != 0)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Loads the game state from a file into a game board, which takes the dimensions and the status of each field from
+/// the file. The header must describe a board of at least one field whose size does not overflow, the file must be
+/// exactly as large as the header demands and every block must pass checkFieldBlocks. All of this is checked before
+/// the board is touched, so a corrupt file leaves the current game intact; the memory of the board is then reused if
+/// it is large enough and the fields are decoded straight into it, filling in the counters of the board on the way. A
+/// file whose blocks fit into one chunk is read only once, larger files are read a second time for decoding.
+/// @param filename The name of the file from which the game state is loaded.
+/// @param board A pointer to the game board, a myBoard structure.
+/// @return Returns 0 on success, 1 if the file cannot be opened or is invalid, leaving the board unchanged, or 2 if
+///         memory allocation for the board fails, which leaves it without fields.
+//---------------------------------------------------------------------------------------------------------------------
+int loadGameStateFromFile(char *filename, myBoard *board)
+{
+  unsigned long long begin = STATS_NOW();
+  FILE *file_pointer = fopen(filename, "rb");
+  if (file_pointer == NULL)
+  {
+    printf(FAILED_TO_OPEN_FILE);
+    return 1;
+  }
+
+  char magic[4];
+  uint64_t height64;
+  uint64_t width64;
+  struct stat status;
+  if (fread(magic, sizeof(char), 4, file_pointer) != 4 || strncmp(magic, MAGIC_NUMBER, 4) != 0 ||
+      fread(&height64, sizeof(height64), 1, file_pointer) != 1 ||
+      fread(&width64, sizeof(width64), 1, file_pointer) != 1 || height64 == 0 || width64 == 0 ||
+      height64 > ULLONG_MAX / width64 || fstat(fileno(file_pointer), &status) != 0)
+  {
+    printf(INVALID_FILE_CONTENT);
+    fclose(file_pointer);
+    return 1;
+  }
+  unsigned long long height = (unsigned long long)height64;
+  unsigned long long width = (unsigned long long)width64;
+  unsigned long long total_fields = height * width;
+  unsigned long long num_blocks = total_fields / 8 + (total_fields % 8 != 0);
+  unsigned long long header_size = 4 + 2 * sizeof(uint64_t);
+  if ((unsigned long long)status.st_size < header_size ||
+      (unsigned long long)status.st_size - header_size != num_blocks * sizeof(myBlockField))
+  {
+    printf(INVALID_FILE_CONTENT);
+    fclose(file_pointer);
+    return 1;
+  }
+  size_t num_fields;
+  if (countBoardFields(height, width, &num_fields) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    fclose(file_pointer);
+    return 1;
+  }
+
+  myBlockField blocks[LOAD_CHUNK_BLOCKS];
+  for (unsigned long long first_block = 0; first_block < num_blocks; first_block += LOAD_CHUNK_BLOCKS)
+  {
+    size_t count = num_blocks - first_block < LOAD_CHUNK_BLOCKS ? num_blocks - first_block : LOAD_CHUNK_BLOCKS;
+    if (fread(blocks, sizeof(myBlockField), count, file_pointer) != count ||
+        checkFieldBlocks(blocks, count, first_block * 8, total_fields) != 0)
+    {
+      printf(INVALID_FILE_CONTENT);
+      fclose(file_pointer);
+      return 1;
+    }
+  }
+  bool reread = num_blocks > LOAD_CHUNK_BLOCKS;
+  if (reread && fseek(file_pointer, (long)header_size, SEEK_SET) != 0)
+  {
+    printf(INVALID_FILE_CONTENT);
+    fclose(file_pointer);
+    return 1;
+  }
+  // the mines are taken from the file, even if the game is procedural
+  board->procedural.enabled = false;
+  if (resizeMemoryBoard(board, height, width) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    fclose(file_pointer);
+    return 2;
+  }
+
+  unsigned long long row = 0;
+  unsigned long long col = 0;
+  unsigned long long field = 0;
+  myBoardCounters counters = {0, 0, 0, 0};
+  for (unsigned long long first_block = 0; first_block < num_blocks; first_block += LOAD_CHUNK_BLOCKS)
+  {
+    size_t count = num_blocks - first_block < LOAD_CHUNK_BLOCKS ? num_blocks - first_block : LOAD_CHUNK_BLOCKS;
+    if (reread)
+    {
+      size_t blocks_read = fread(blocks, sizeof(myBlockField), count, file_pointer);
+      // fewer blocks are only read if the file shrank since it was checked
+      memset(blocks + blocks_read, 0, (count - blocks_read) * sizeof(myBlockField));
+    }
+
+    for (size_t b = 0; b < count; b++)
+    {
+      for (int bit_position = 0; bit_position < 8 && field < total_fields; bit_position++, field++)
+      {
+        myField loaded = {(blocks[b].mine_bits & (1 << bit_position)) != 0,
+                          (blocks[b].open_bits & (1 << bit_position)) != 0, 0,
+                          (blocks[b].flag_bits & (1 << bit_position)) != 0};
+        writeBoardField(board, row, col, loaded);
+        counters.mines += loaded.is_bomb;
+        counters.flags += loaded.is_flagged;
+        counters.opened += loaded.is_opened;
+        counters.closed_safe += !loaded.is_opened & !loaded.is_bomb;
+        if (++col == width)
+        {
+          col = 0;
+          row++;
+        }
+      }
+    }
+  }
+
+  fclose(file_pointer);
+  board->counters = counters;
+  STATS_ADD(loaded_bytes, header_size + num_blocks * sizeof(myBlockField));
+  STATS_ADD(load_ns, STATS_NOW() - begin);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Scrambles the bits of a 64-bit value, used to spread keys over the slots of a hash map.
+/// @param value The value to scramble.
+/// @return The scrambled value.
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t mixBits(uint64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Initializes an empty hash map with room for the given number of entries.
+/// @param map The map to initialize.
+/// @param expected The number of entries the map should hold without growing.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int initIndexMap(myIndexMap *map, size_t expected)
+{
+  size_t capacity = 16;
+  while (capacity < expected * 2)
+  {
+    capacity <<= 1;
+  }
+
+  map->keys = malloc(capacity * sizeof(unsigned long long));
+  map->values = malloc(capacity * sizeof(size_t));
+  if (map->keys == NULL || map->values == NULL)
+  {
+    free(map->keys);
+    free(map->values);
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = 0;
+    map->size = 0;
+    return 1;
+  }
+
+  for (size_t i = 0; i < capacity; i++)
+  {
+    map->values[i] = SIZE_MAX;
+  }
+  map->capacity = capacity;
+  map->size = 0;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the memory of a hash map and leaves it empty.
+/// @param map The map to free.
+//---------------------------------------------------------------------------------------------------------------------
+void freeIndexMap(myIndexMap *map)
+{
+  free(map->keys);
+  free(map->values);
+  map->keys = NULL;
+  map->values = NULL;
+  map->capacity = 0;
+  map->size = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Looks up a key in a hash map.
+/// @param map The map to search.
+/// @param key The key to look up.
+/// @return The value stored for the key, or SIZE_MAX if the key is not in the map.
+//---------------------------------------------------------------------------------------------------------------------
+size_t findIndexMap(const myIndexMap *map, unsigned long long key)
+{
+  if (map->capacity == 0)
+  {
+    return SIZE_MAX;
+  }
+
+  size_t slot = mixBits(key) & (map->capacity - 1);
+  while (map->values[slot] != SIZE_MAX)
+  {
+    if (map->keys[slot] == key)
+    {
+      return map->values[slot];
+    }
+    slot = (slot + 1) & (map->capacity - 1);
+  }
+  return SIZE_MAX;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Inserts a key into a hash map or replaces its value, growing the map if it becomes too full.
+/// @param map The map to insert into.
+/// @param key The key to insert.
+/// @param value The value to store, must not be SIZE_MAX.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int insertIndexMap(myIndexMap *map, unsigned long long key, size_t value)
+{
+  if ((map->size + 1) * 2 > map->capacity)
+  {
+    myIndexMap grown;
+    if (initIndexMap(&grown, map->capacity) != 0)
+    {
+      return 1;
+    }
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+      if (map->values[i] != SIZE_MAX)
+      {
+        insertIndexMap(&grown, map->keys[i], map->values[i]);
+      }
+    }
+    freeIndexMap(map);
+    *map = grown;
+  }
+
+  size_t slot = mixBits(key) & (map->capacity - 1);
+  while (map->values[slot] != SIZE_MAX)
+  {
+    if (map->keys[slot] == key)
+    {
+      map->values[slot] = value;
+      return 0;
+    }
+    slot = (slot + 1) & (map->capacity - 1);
+  }
+  map->keys[slot] = key;
+  map->values[slot] = value;
+  map->size++;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Makes sure a growable array has room for the given number of elements, doubling its capacity when needed.
+/// @param array Pointer to the array, which may be reallocated.
+/// @param capacity Pointer to the current capacity of the array in elements.
+/// @param needed The number of elements the array must be able to hold.
+/// @param element_size The size of a single element.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int reserveArray(void **array, size_t *capacity, size_t needed, size_t element_size)
+{
+  if (needed <= *capacity)
+  {
+    return 0;
+  }
+
+  size_t new_capacity = *capacity == 0 ? 16 : *capacity;
+  while (new_capacity < needed)
+  {
+    new_capacity *= 2;
+  }
+
+  void *grown = realloc(*array, new_capacity * element_size);
+  if (grown == NULL)
+  {
+    return 1;
+  }
+  *array = grown;
+  *capacity = new_capacity;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the memory of a frontier.
+/// @param frontier The frontier to free.
+//---------------------------------------------------------------------------------------------------------------------
+void freeFrontier(myFrontier *frontier)
+{
+  freeIndexMap(&frontier->index);
+  free(frontier->fields);
+  free(frontier->constraints);
+  frontier->fields = NULL;
+  frontier->constraints = NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Adds the constraint of an opened field without a mine to the frontier: how many of its closed neighbours hide a
+/// mine. The neighbours are added to the frontier unless they are in it already.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param row The row of the opened field.
+/// @param col The column of the opened field.
+/// @param frontier The frontier to add to.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int addFrontierConstraint(myBoard *board, unsigned long long height, unsigned long long width, unsigned long long row,
+                          unsigned long long col, myFrontier *frontier)
+{
+  // the number shown on the field, minus the mines already opened around it
+  myProbConstraint constraint;
+  constraint.target = 0;
+  constraint.num_fields = 0;
+  for (int x = -1; x <= 1; x++)
+  {
+    for (int y = -1; y <= 1; y++)
+    {
+      unsigned long long new_row = row + x;
+      unsigned long long new_col = col + y;
+      if ((x == 0 && y == 0) || new_row >= height || new_col >= width ||
+          readBoardField(board, new_row, new_col).is_opened)
+      {
+        continue;
+      }
+      if (readBoardField(board, new_row, new_col).is_bomb)
+      {
+        constraint.target++;
+      }
+
+      unsigned long long key = new_row * width + new_col;
+      size_t field = findIndexMap(&frontier->index, key);
+      if (field == SIZE_MAX)
+      {
+        field = frontier->num_fields;
+        if (reserveArray((void **)&frontier->fields, &frontier->fields_capacity, field + 1,
+                         sizeof(unsigned long long)) != 0 ||
+            insertIndexMap(&frontier->index, key, field) != 0)
+        {
+          return 1;
+        }
+        frontier->fields[frontier->num_fields++] = key;
+      }
+      constraint.fields[constraint.num_fields++] = field;
+    }
+  }
+
+  if (constraint.num_fields == 0)
+  {
+    return 0;
+  }
+  if (reserveArray((void **)&frontier->constraints, &frontier->constraints_capacity, frontier->num_constraints + 1,
+                   sizeof(myProbConstraint)) != 0)
+  {
+    return 1;
+  }
+  frontier->constraints[frontier->num_constraints++] = constraint;
+  return 0;
+}
+
+#ifdef A4_TIERED_BOARD
+//---------------------------------------------------------------------------------------------------------------------
+/// Compares two field indices for qsort.
+/// @param first Pointer to the first index.
+/// @param second Pointer to the second index.
+/// @return Negative, zero or positive like strcmp.
+//---------------------------------------------------------------------------------------------------------------------
+int compareFieldIndices(const void *first, const void *second)
+{
+  unsigned long long a = *(const unsigned long long *)first;
+  unsigned long long b = *(const unsigned long long *)second;
+  return (a > b) - (a < b);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Collects the frontier of a procedural board in the tiered layout from its played tiles, which hold all of its
+/// opened fields, so the time follows the fields played instead of the board. The opened fields are sorted to be
+/// visited in the same order as on a stored board. The closed fields and their mines are taken from the counters of
+/// the board, so beyond PROCEDURAL_COUNT_FIELDS the mines are the number given rather than the exact one.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param frontier The frontier to fill.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int buildPlayedFrontier(myBoard *board, unsigned long long height, unsigned long long width, myFrontier *frontier)
+{
+  const myBoardTiers *tiers = &board->tiers;
+  unsigned long long *opened = NULL;
+  size_t num_opened = 0;
+  size_t opened_capacity = 0;
+  unsigned long long opened_mines = 0;
+  for (size_t slot = 0; slot < tiers->directory.capacity; slot++)
+  {
+    if (tiers->directory.values[slot] == SIZE_MAX)
+    {
+      continue;
+    }
+    unsigned long long tile = tiers->directory.keys[slot];
+    unsigned long long tile_row = tile / board->tile_columns * BOARD_TILE;
+    unsigned long long tile_col = tile % board->tile_columns * BOARD_TILE;
+    for (unsigned field = 0; field < BOARD_TILE * BOARD_TILE; field++)
+    {
+      unsigned long long row = tile_row + (field >> BOARD_TILE_SHIFT);
+      unsigned long long col = tile_col + (field & (BOARD_TILE - 1));
+      if (row >= height || col >= width || !readBoardField(board, row, col).is_opened)
+      {
+        continue;
+      }
+      if (readBoardField(board, row, col).is_bomb)
+      {
+        opened_mines++;
+        continue;
+      }
+      if (reserveArray((void **)&opened, &opened_capacity, num_opened + 1, sizeof(unsigned long long)) != 0)
+      {
+        free(opened);
+        return 1;
+      }
+      opened[num_opened++] = row * width + col;
+    }
+  }
+  qsort(opened, num_opened, sizeof(unsigned long long), compareFieldIndices);
+
+  frontier->closed_fields = height * width - board->counters.opened;
+  frontier->hidden_mines = board->counters.mines > opened_mines ? board->counters.mines - opened_mines : 0;
+  frontier->hidden_mines =
+      frontier->hidden_mines > frontier->closed_fields ? frontier->closed_fields : frontier->hidden_mines;
+  for (size_t field = 0; field < num_opened; field++)
+  {
+    if (addFrontierConstraint(board, height, width, opened[field] / width, opened[field] % width, frontier) != 0)
+    {
+      free(opened);
+      return 1;
+    }
+  }
+  free(opened);
+  return 0;
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Collects the frontier of the board: every closed field next to an opened field, together with one constraint per
+/// opened field that tells how many of its closed neighbours hide a mine. Flags are only guesses of the player and
+/// are therefore treated like closed fields.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param frontier The frontier to fill.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int buildFrontier(myBoard *board, unsigned long long height, unsigned long long width, myFrontier *frontier)
+{
+  memset(frontier, 0, sizeof(*frontier));
+#ifdef A4_TIERED_BOARD
+  if (board->procedural.enabled && board->tiers.tiles == NULL)
+  {
+    return buildPlayedFrontier(board, height, width, frontier);
+  }
+#endif
+
+  for (unsigned long long row = 0; row < height; row++)
+  {
+    for (unsigned long long col = 0; col < width; col++)
+    {
+      if (readBoardField(board, row, col).is_opened == false)
+      {
+        frontier->closed_fields++;
+        if (readBoardField(board, row, col).is_bomb)
+        {
+          frontier->hidden_mines++;
+        }
+        continue;
+      }
+      if (readBoardField(board, row, col).is_bomb)
+      {
+        continue;
+      }
+      if (addFrontierConstraint(board, height, width, row, col, frontier) != 0)
+      {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the layers and results of a component, so it can be solved again.
+/// @param component The component to clear.
+//---------------------------------------------------------------------------------------------------------------------
+void clearProbabilityComponent(myProbComponent *component)
+{
+  free(component->layer_start);
+  free(component->next_safe);
+  free(component->next_mine);
+  free(component->poly_lo);
+  free(component->poly_length);
+  free(component->poly_offset);
+  free(component->poly_pool);
+  free(component->total);
+  component->layer_start = NULL;
+  component->next_safe = NULL;
+  component->next_mine = NULL;
+  component->states_capacity = 0;
+  component->poly_lo = NULL;
+  component->poly_length = NULL;
+  component->poly_offset = NULL;
+  component->poly_pool = NULL;
+  component->pool_size = 0;
+  component->pool_capacity = 0;
+  component->total = NULL;
+  component->total_lo = 0;
+  component->total_length = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees a solved component together with all of its layers.
+/// @param component The component to free, may be NULL.
+//---------------------------------------------------------------------------------------------------------------------
+void freeProbabilityComponent(myProbComponent *component)
+{
+  if (component == NULL)
+  {
+    return;
+  }
+  clearProbabilityComponent(component);
+  free(component->signature);
+  free(component);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Drops the polynomials kept for exact results, after which the component can only be solved approximately.
+/// @param component The component whose polynomials are freed.
+//---------------------------------------------------------------------------------------------------------------------
+void dropExactPolynomials(myProbComponent *component)
+{
+  free(component->poly_lo);
+  free(component->poly_length);
+  free(component->poly_offset);
+  free(component->poly_pool);
+  component->poly_lo = NULL;
+  component->poly_length = NULL;
+  component->poly_offset = NULL;
+  component->poly_pool = NULL;
+  component->pool_size = 0;
+  component->pool_capacity = 0;
+  component->exact = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Hashes the needs of the active constraints of a state.
+/// @param key The needs, one byte per active constraint.
+/// @param length The number of active constraints.
+/// @return The hash of the state.
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t hashStateKey(const uint8_t *key, size_t length)
+{
+  uint64_t hash = 1469598103934665603ULL;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash = (hash ^ key[i]) * 1099511628211ULL;
+  }
+  return mixBits(hash ^ length);
+}
+
+typedef struct _state_mass_
+{
+  double mass;
+  size_t state;
+} myStateMass;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Orders states by decreasing mass, ties by increasing index so the result does not depend on qsort.
+//---------------------------------------------------------------------------------------------------------------------
+int compareStateMass(const void *first, const void *second)
+{
+  const myStateMass *a = first;
+  const myStateMass *b = second;
+  if (a->mass != b->mass)
+  {
+    return a->mass > b->mass ? -1 : 1;
+  }
+  return a->state < b->state ? -1 : (a->state > b->state);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Enumerates all mine layouts of one frontier component. The fields are decided one after another; a state holds
+/// how many mines each constraint that is currently "open" still needs, so layouts which agree on that are merged
+/// (memoized) instead of being enumerated separately. For every state the number of layouts is kept as a polynomial
+/// over the number of mines placed so far. If a field has more than max_states states, the least likely ones are
+/// dropped and the component is marked as approximate.
+/// @param component The component to solve; num_fields must be set.
+/// @param constraints The constraints of the component, their fields are sorted positions inside the component.
+/// @param num_constraints The number of constraints.
+/// @param max_states The number of states kept per field.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int solveProbabilityComponent(myProbComponent *component, const myProbConstraint *constraints, size_t num_constraints,
+                              size_t max_states)
+{
+  size_t n = component->num_fields;
+  int result = 1;
+
+  // constraints containing each position, and constraints starting at each position
+  size_t *contains_start = calloc(n + 1, sizeof(size_t));
+  size_t *contains = malloc((num_constraints * 8 + 1) * sizeof(size_t));
+  size_t *entering_start = calloc(n + 1, sizeof(size_t));
+  size_t *entering = malloc((num_constraints + 1) * sizeof(size_t));
+  uint8_t *marked = calloc(num_constraints + 1, sizeof(uint8_t));
+  size_t *cur_active = malloc((num_constraints + 1) * sizeof(size_t));
+  size_t *next_active = malloc((num_constraints + 1) * sizeof(size_t));
+  size_t *active_map = malloc((num_constraints + 1) * sizeof(size_t));
+  size_t *entering_map = malloc((num_constraints + 1) * sizeof(size_t));
+  int *remaining = malloc((num_constraints + 1) * sizeof(int));
+  uint8_t *key = malloc(num_constraints + 1);
+  component->layer_start = calloc(n + 2, sizeof(size_t));
+
+  // current and next layer: keys, transitions, polynomials
+  uint8_t *cur_keys = NULL, *next_keys = NULL;
+  size_t cur_keys_capacity = 0, next_keys_capacity = 0;
+  size_t *cur_lo = NULL, *cur_length = NULL, *cur_offset = NULL;
+  size_t *next_lo = NULL, *next_length = NULL, *next_offset = NULL;
+  size_t cur_states_capacity = 0, next_states_capacity = 0;
+  double *cur_pool = NULL, *next_pool = NULL;
+  size_t cur_pool_capacity = 0, next_pool_capacity = 0;
+  size_t *trans_safe = NULL, *trans_mine = NULL, *remap = NULL;
+  size_t trans_capacity = 0, trans_mine_capacity = 0, remap_capacity = 0;
+  size_t *slots = NULL;
+  size_t slots_capacity = 0;
+  myStateMass *masses = NULL;
+  size_t masses_capacity = 0;
+
+  if (contains_start == NULL || contains == NULL || entering_start == NULL || entering == NULL || marked == NULL ||
+      cur_active == NULL || next_active == NULL || active_map == NULL || entering_map == NULL || remaining == NULL ||
+      key == NULL || component->layer_start == NULL)
+  {
+    goto cleanup;
+  }
+
+  for (size_t c = 0; c < num_constraints; c++)
+  {
+    for (int k = 0; k < constraints[c].num_fields; k++)
+    {
+      contains_start[constraints[c].fields[k] + 1]++;
+    }
+    entering_start[constraints[c].fields[0] + 1]++;
+  }
+  for (size_t i = 0; i < n; i++)
+  {
+    contains_start[i + 1] += contains_start[i];
+    entering_start[i + 1] += entering_start[i];
+  }
+  {
+    size_t *contains_fill = malloc((n + 1) * sizeof(size_t));
+    size_t *entering_fill = malloc((n + 1) * sizeof(size_t));
+    if (contains_fill == NULL || entering_fill == NULL)
+    {
+      free(contains_fill);
+      free(entering_fill);
+      goto cleanup;
+    }
+    memcpy(contains_fill, contains_start, (n + 1) * sizeof(size_t));
+    memcpy(entering_fill, entering_start, (n + 1) * sizeof(size_t));
+    for (size_t c = 0; c < num_constraints; c++)
+    {
+      for (int k = 0; k < constraints[c].num_fields; k++)
+      {
+        contains[contains_fill[constraints[c].fields[k]]++] = c;
+      }
+      entering[entering_fill[constraints[c].fields[0]]++] = c;
+    }
+    free(contains_fill);
+    free(entering_fill);
+  }
+
+  // layer 0: nothing decided yet, a single state with an empty key
+  size_t cur_count = 1;
+  size_t cur_len = 0;
+  if (reserveArray((void **)&cur_keys, &cur_keys_capacity, 1, 1) != 0 ||
+      reserveArray((void **)&cur_lo, &cur_states_capacity, 1, sizeof(size_t)) != 0 ||
+      reserveArray((void **)&cur_pool, &cur_pool_capacity, 1, sizeof(double)) != 0)
+  {
+    goto cleanup;
+  }
+  cur_length = malloc(cur_states_capacity * sizeof(size_t));
+  cur_offset = malloc(cur_states_capacity * sizeof(size_t));
+  if (cur_length == NULL || cur_offset == NULL)
+  {
+    goto cleanup;
+  }
+  cur_lo[0] = 0;
+  cur_length[0] = 1;
+  cur_offset[0] = 0;
+  cur_pool[0] = 1.0;
+
+  component->exact = true;
+  component->pruned = false;
+  if (reserveArray((void **)&component->poly_pool, &component->pool_capacity, 1, sizeof(double)) != 0)
+  {
+    goto cleanup;
+  }
+  component->poly_pool[0] = 1.0;
+  component->pool_size = 1;
+
+  for (size_t i = 0; i <= n; i++)
+  {
+    size_t first_state = component->layer_start[i];
+    component->layer_start[i + 1] = first_state + cur_count;
+
+    // keep the structure (and in exact mode the polynomials) of the current layer
+    size_t states_needed = first_state + cur_count;
+    if (states_needed > component->states_capacity)
+    {
+      size_t capacity = component->states_capacity;
+      if (reserveArray((void **)&component->next_safe, &capacity, states_needed, sizeof(size_t)) != 0)
+      {
+        goto cleanup;
+      }
+      size_t *grown_mine = realloc(component->next_mine, capacity * sizeof(size_t));
+      if (grown_mine == NULL)
+      {
+        goto cleanup;
+      }
+      component->next_mine = grown_mine;
+      if (component->exact)
+      {
+        size_t *grown_lo = realloc(component->poly_lo, capacity * sizeof(size_t));
+        if (grown_lo != NULL)
+        {
+          component->poly_lo = grown_lo;
+        }
+        size_t *grown_length = realloc(component->poly_length, capacity * sizeof(size_t));
+        if (grown_length != NULL)
+        {
+          component->poly_length = grown_length;
+        }
+        size_t *grown_offset = realloc(component->poly_offset, capacity * sizeof(size_t));
+        if (grown_offset != NULL)
+        {
+          component->poly_offset = grown_offset;
+        }
+        if (grown_lo == NULL || grown_length == NULL || grown_offset == NULL)
+        {
+          goto cleanup;
+        }
+      }
+      component->states_capacity = capacity;
+    }
+    if (component->exact)
+    {
+      size_t base = i == 0 ? 0 : component->pool_size;
+      size_t layer_size = cur_offset[cur_count - 1] + cur_length[cur_count - 1];
+      if (i > 0)
+      {
+        if (component->pool_size + layer_size > PROB_EXACT_BUDGET)
+        {
+          dropExactPolynomials(component);
+        }
+        else if (reserveArray((void **)&component->poly_pool, &component->pool_capacity,
+                              component->pool_size + layer_size, sizeof(double)) != 0)
+        {
+          goto cleanup;
+        }
+        else
+        {
+          memcpy(component->poly_pool + base, cur_pool, layer_size * sizeof(double));
+          component->pool_size += layer_size;
+        }
+      }
+      if (component->exact)
+      {
+        for (size_t s = 0; s < cur_count; s++)
+        {
+          component->poly_lo[first_state + s] = cur_lo[s];
+          component->poly_length[first_state + s] = cur_length[s];
+          component->poly_offset[first_state + s] = base + cur_offset[s];
+        }
+      }
+    }
+
+    if (i == n)
+    {
+      break;
+    }
+
+    // active constraints after field i: the surviving ones keep their order, new ones are appended
+    size_t next_len = 0;
+    for (size_t idx = 0; idx < cur_len; idx++)
+    {
+      size_t c = cur_active[idx];
+      size_t last = constraints[c].fields[constraints[c].num_fields - 1];
+      active_map[idx] = last == i ? SIZE_MAX : next_len;
+      if (last != i)
+      {
+        next_active[next_len++] = c;
+      }
+    }
+    for (size_t e = entering_start[i]; e < entering_start[i + 1]; e++)
+    {
+      size_t c = entering[e];
+      size_t last = constraints[c].fields[constraints[c].num_fields - 1];
+      entering_map[e - entering_start[i]] = last == i ? SIZE_MAX : next_len;
+      if (last != i)
+      {
+        next_active[next_len++] = c;
+      }
+    }
+    for (size_t idx = 0; idx < next_len; idx++)
+    {
+      size_t c = next_active[idx];
+      remaining[idx] = 0;
+      for (int k = 0; k < constraints[c].num_fields; k++)
+      {
+        if (constraints[c].fields[k] > i)
+        {
+          remaining[idx]++;
+        }
+      }
+    }
+    for (size_t k = contains_start[i]; k < contains_start[i + 1]; k++)
+    {
+      marked[contains[k]] = 1;
+    }
+
+    // discover the states after field i
+    size_t slot_count = 16;
+    while (slot_count < cur_count * 4)
+    {
+      slot_count <<= 1;
+    }
+    if (reserveArray((void **)&slots, &slots_capacity, slot_count, sizeof(size_t)) != 0 ||
+        reserveArray((void **)&trans_safe, &trans_capacity, cur_count, sizeof(size_t)) != 0 ||
+        reserveArray((void **)&next_keys, &next_keys_capacity, cur_count * 2 * (next_len + 1), 1) != 0)
+    {
+      goto cleanup;
+    }
+    if (trans_capacity > trans_mine_capacity)
+    {
+      size_t *grown = realloc(trans_mine, trans_capacity * sizeof(size_t));
+      if (grown == NULL)
+      {
+        goto cleanup;
+      }
+      trans_mine = grown;
+      trans_mine_capacity = trans_capacity;
+    }
+    for (size_t s = 0; s < slot_count; s++)
+    {
+      slots[s] = SIZE_MAX;
+    }
+
+    size_t next_count = 0;
+    for (size_t s = 0; s < cur_count; s++)
+    {
+      const uint8_t *cur_key = cur_keys + s * cur_len;
+      for (int mine = 0; mine <= 1; mine++)
+      {
+        bool valid = true;
+        for (size_t idx = 0; idx < cur_len && valid; idx++)
+        {
+          int need = cur_key[idx] - (mine && marked[cur_active[idx]]);
+          if (need < 0 || (active_map[idx] == SIZE_MAX && need != 0) ||
+              (active_map[idx] != SIZE_MAX && need > remaining[active_map[idx]]))
+          {
+            valid = false;
+          }
+          else if (active_map[idx] != SIZE_MAX)
+          {
+            key[active_map[idx]] = (uint8_t)need;
+          }
+        }
+        for (size_t e = entering_start[i]; e < entering_start[i + 1] && valid; e++)
+        {
+          size_t mapped = entering_map[e - entering_start[i]];
+          int need = constraints[entering[e]].target - mine;
+          if (need < 0 || (mapped == SIZE_MAX && need != 0) || (mapped != SIZE_MAX && need > remaining[mapped]))
+          {
+            valid = false;
+          }
+          else if (mapped != SIZE_MAX)
+          {
+            key[mapped] = (uint8_t)need;
+          }
+        }
+
+        size_t target_state = SIZE_MAX;
+        if (valid)
+        {
+          size_t slot = hashStateKey(key, next_len) & (slot_count - 1);
+          while (slots[slot] != SIZE_MAX &&
+                 memcmp(next_keys + slots[slot] * next_len, key, next_len) != 0)
+          {
+            slot = (slot + 1) & (slot_count - 1);
+          }
+          if (slots[slot] == SIZE_MAX)
+          {
+            slots[slot] = next_count;
+            memcpy(next_keys + next_count * next_len, key, next_len);
+            next_count++;
+          }
+          target_state = slots[slot];
+        }
+        if (mine)
+        {
+          trans_mine[s] = target_state;
+        }
+        else
+        {
+          trans_safe[s] = target_state;
+        }
+      }
+    }
+    for (size_t k = contains_start[i]; k < contains_start[i + 1]; k++)
+    {
+      marked[contains[k]] = 0;
+    }
+
+    // support of the polynomials of the next layer
+    if (reserveArray((void **)&next_lo, &next_states_capacity, next_count + 1, sizeof(size_t)) != 0)
+    {
+      goto cleanup;
+    }
+    {
+      size_t *grown_length = realloc(next_length, next_states_capacity * sizeof(size_t));
+      if (grown_length != NULL)
+      {
+        next_length = grown_length;
+      }
+      size_t *grown_offset = realloc(next_offset, next_states_capacity * sizeof(size_t));
+      if (grown_offset != NULL)
+      {
+        next_offset = grown_offset;
+      }
+      if (grown_length == NULL || grown_offset == NULL)
+      {
+        goto cleanup;
+      }
+    }
+    for (size_t s = 0; s < next_count; s++)
+    {
+      next_lo[s] = SIZE_MAX;
+      next_length[s] = 0; // used as "end" while collecting
+    }
+    for (size_t s = 0; s < cur_count; s++)
+    {
+      for (int mine = 0; mine <= 1; mine++)
+      {
+        size_t target_state = mine ? trans_mine[s] : trans_safe[s];
+        if (target_state == SIZE_MAX || cur_length[s] == 0)
+        {
+          continue;
+        }
+        size_t lo = cur_lo[s] + mine;
+        size_t end = lo + cur_length[s];
+        if (lo < next_lo[target_state])
+        {
+          next_lo[target_state] = lo;
+        }
+        if (end > next_length[target_state])
+        {
+          next_length[target_state] = end;
+        }
+      }
+    }
+    size_t next_pool_size = 0;
+    for (size_t s = 0; s < next_count; s++)
+    {
+      if (next_lo[s] == SIZE_MAX)
+      {
+        next_lo[s] = 0;
+      }
+      next_length[s] = next_length[s] > next_lo[s] ? next_length[s] - next_lo[s] : 0;
+      next_offset[s] = next_pool_size;
+      next_pool_size += next_length[s];
+    }
+    if (reserveArray((void **)&next_pool, &next_pool_capacity, next_pool_size + 1, sizeof(double)) != 0)
+    {
+      goto cleanup;
+    }
+    memset(next_pool, 0, (next_pool_size + 1) * sizeof(double));
+    for (size_t s = 0; s < cur_count; s++)
+    {
+      for (int mine = 0; mine <= 1; mine++)
+      {
+        size_t target_state = mine ? trans_mine[s] : trans_safe[s];
+        if (target_state == SIZE_MAX)
+        {
+          continue;
+        }
+        double *target = next_pool + next_offset[target_state] + (cur_lo[s] + mine - next_lo[target_state]);
+        const double *source = cur_pool + cur_offset[s];
+        for (size_t t = 0; t < cur_length[s]; t++)
+        {
+          target[t] += source[t];
+        }
+      }
+    }
+
+    // drop the least likely states if there are too many of them
+    if (next_count > max_states)
+    {
+      if (reserveArray((void **)&masses, &masses_capacity, next_count, sizeof(myStateMass)) != 0 ||
+          reserveArray((void **)&remap, &remap_capacity, next_count, sizeof(size_t)) != 0)
+      {
+        goto cleanup;
+      }
+      for (size_t s = 0; s < next_count; s++)
+      {
+        masses[s].mass = 0.0;
+        masses[s].state = s;
+        for (size_t t = 0; t < next_length[s]; t++)
+        {
+          masses[s].mass += next_pool[next_offset[s] + t];
+        }
+      }
+      qsort(masses, next_count, sizeof(myStateMass), compareStateMass);
+      for (size_t s = 0; s < next_count; s++)
+      {
+        remap[s] = SIZE_MAX;
+      }
+      for (size_t s = 0; s < max_states; s++)
+      {
+        remap[masses[s].state] = 0;
+      }
+      size_t kept = 0;
+      for (size_t s = 0; s < next_count; s++)
+      {
+        if (remap[s] == SIZE_MAX)
+        {
+          continue;
+        }
+        remap[s] = kept;
+        memmove(next_keys + kept * next_len, next_keys + s * next_len, next_len);
+        next_lo[kept] = next_lo[s];
+        next_length[kept] = next_length[s];
+        next_offset[kept] = next_offset[s];
+        kept++;
+      }
+      for (size_t s = 0; s < cur_count; s++)
+      {
+        trans_safe[s] = trans_safe[s] == SIZE_MAX ? SIZE_MAX : remap[trans_safe[s]];
+        trans_mine[s] = trans_mine[s] == SIZE_MAX ? SIZE_MAX : remap[trans_mine[s]];
+      }
+      next_count = kept;
+      component->pruned = true;
+    }
+
+    // trim negligible entries and rescale the layer so the numbers stay in range
+    double layer_max = 0.0;
+    for (size_t s = 0; s < next_count; s++)
+    {
+      double *poly = next_pool + next_offset[s];
+      double state_max = 0.0;
+      for (size_t t = 0; t < next_length[s]; t++)
+      {
+        state_max = poly[t] > state_max ? poly[t] : state_max;
+      }
+      size_t skip = 0;
+      while (skip < next_length[s] && poly[skip] < state_max * PROB_TRIM)
+      {
+        skip++;
+      }
+      size_t length = next_length[s];
+      while (length > skip && poly[length - 1] < state_max * PROB_TRIM)
+      {
+        length--;
+      }
+      next_lo[s] += skip;
+      next_offset[s] += skip;
+      next_length[s] = length - skip;
+      layer_max = state_max > layer_max ? state_max : layer_max;
+    }
+    // compact the pool so exact mode can copy it in one piece
+    size_t compact = 0;
+    for (size_t s = 0; s < next_count; s++)
+    {
+      memmove(next_pool + compact, next_pool + next_offset[s], next_length[s] * sizeof(double));
+      next_offset[s] = compact;
+      compact += next_length[s];
+    }
+    if (layer_max > 0.0)
+    {
+      for (size_t t = 0; t < compact; t++)
+      {
+        next_pool[t] /= layer_max;
+      }
+    }
+
+    for (size_t s = 0; s < cur_count; s++)
+    {
+      component->next_safe[first_state + s] =
+          trans_safe[s] == SIZE_MAX ? SIZE_MAX : first_state + cur_count + trans_safe[s];
+      component->next_mine[first_state + s] =
+          trans_mine[s] == SIZE_MAX ? SIZE_MAX : first_state + cur_count + trans_mine[s];
+    }
+
+    // the next layer becomes the current one
+    uint8_t *swap_keys = cur_keys;
+    cur_keys = next_keys;
+    next_keys = swap_keys;
+    size_t swap_capacity = cur_keys_capacity;
+    cur_keys_capacity = next_keys_capacity;
+    next_keys_capacity = swap_capacity;
+    size_t *swap_array = cur_lo;
+    cur_lo = next_lo;
+    next_lo = swap_array;
+    swap_array = cur_length;
+    cur_length = next_length;
+    next_length = swap_array;
+    swap_array = cur_offset;
+    cur_offset = next_offset;
+    next_offset = swap_array;
+    swap_capacity = cur_states_capacity;
+    cur_states_capacity = next_states_capacity;
+    next_states_capacity = swap_capacity;
+    double *swap_pool = cur_pool;
+    cur_pool = next_pool;
+    next_pool = swap_pool;
+    swap_capacity = cur_pool_capacity;
+    cur_pool_capacity = next_pool_capacity;
+    next_pool_capacity = swap_capacity;
+    swap_array = cur_active;
+    cur_active = next_active;
+    next_active = swap_array;
+    cur_count = next_count;
+    cur_len = next_len;
+    if (cur_count == 0)
+    {
+      // no layout fits, all following layers stay empty
+      for (size_t rest = i + 1; rest <= n; rest++)
+      {
+        component->layer_start[rest + 1] = component->layer_start[rest];
+      }
+      break;
+    }
+  }
+
+  // after the last field all constraints are closed, so at most one state is left
+  component->total_lo = 0;
+  component->total_length = 0;
+  component->total = NULL;
+  if (cur_count > 0)
+  {
+    component->total_lo = cur_lo[0];
+    component->total_length = cur_length[0];
+    component->total = malloc((cur_length[0] + 1) * sizeof(double));
+    if (component->total == NULL)
+    {
+      goto cleanup;
+    }
+    memcpy(component->total, cur_pool + cur_offset[0], cur_length[0] * sizeof(double));
+  }
+  result = 0;
+
+cleanup:
+  free(contains_start);
+  free(contains);
+  free(entering_start);
+  free(entering);
+  free(marked);
+  free(cur_active);
+  free(next_active);
+  free(active_map);
+  free(entering_map);
+  free(remaining);
+  free(key);
+  free(cur_keys);
+  free(next_keys);
+  free(cur_lo);
+  free(cur_length);
+  free(cur_offset);
+  free(next_lo);
+  free(next_length);
+  free(next_offset);
+  free(cur_pool);
+  free(next_pool);
+  free(trans_safe);
+  free(trans_mine);
+  free(remap);
+  free(slots);
+  free(masses);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Computes the exact mine probability of every field of a component. The layouts are weighted by how many ways the
+/// rest of the board can be filled with the remaining mines, given as a weight per mine count of the component.
+/// Walking backwards, every state gets the weight of all its completions per number of mines placed before it.
+/// @param component A component solved in exact mode.
+/// @param weights Weight per number of mines in the component, num_fields + 1 entries.
+/// @param marginals Receives the mine probability per position of the component.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int computeExactMarginals(const myProbComponent *component, const double *weights, double *marginals)
+{
+  size_t n = component->num_fields;
+  size_t largest_layer = 0;
+  for (size_t i = 0; i <= n; i++)
+  {
+    size_t first = component->layer_start[i];
+    size_t last = component->layer_start[i + 1];
+    if (last > first)
+    {
+      size_t size = component->poly_offset[last - 1] + component->poly_length[last - 1] - component->poly_offset[first];
+      largest_layer = size > largest_layer ? size : largest_layer;
+    }
+  }
+
+  double *next_weights = calloc(largest_layer + 1, sizeof(double));
+  double *cur_weights = calloc(largest_layer + 1, sizeof(double));
+  if (next_weights == NULL || cur_weights == NULL)
+  {
+    free(next_weights);
+    free(cur_weights);
+    return 1;
+  }
+
+  // after the last field only the mine count of the whole component matters
+  for (size_t s = component->layer_start[n]; s < component->layer_start[n + 1]; s++)
+  {
+    size_t base = component->poly_offset[component->layer_start[n]];
+    for (size_t t = 0; t < component->poly_length[s]; t++)
+    {
+      next_weights[component->poly_offset[s] - base + t] = weights[component->poly_lo[s] + t];
+    }
+  }
+
+  for (size_t i = n; i-- > 0;)
+  {
+    size_t base = component->poly_offset[component->layer_start[i]];
+    size_t next_base = component->layer_start[i + 2] > component->layer_start[i + 1]
+                           ? component->poly_offset[component->layer_start[i + 1]]
+                           : 0;
+    double mine_weight = 0.0;
+    double total_weight = 0.0;
+    double layer_max = 0.0;
+
+    for (size_t s = component->layer_start[i]; s < component->layer_start[i + 1]; s++)
+    {
+      const double *forward = component->poly_pool + component->poly_offset[s];
+      double *backward = cur_weights + component->poly_offset[s] - base;
+      size_t safe = component->next_safe[s];
+      size_t mine = component->next_mine[s];
+      for (size_t t = 0; t < component->poly_length[s]; t++)
+      {
+        size_t placed = component->poly_lo[s] + t;
+        double safe_weight = 0.0;
+        double mine_completion = 0.0;
+        if (safe != SIZE_MAX && placed >= component->poly_lo[safe] &&
+            placed < component->poly_lo[safe] + component->poly_length[safe])
+        {
+          safe_weight = next_weights[component->poly_offset[safe] - next_base + placed - component->poly_lo[safe]];
+        }
+        if (mine != SIZE_MAX && placed + 1 >= component->poly_lo[mine] &&
+            placed + 1 < component->poly_lo[mine] + component->poly_length[mine])
+        {
+          mine_completion = next_weights[component->poly_offset[mine] - next_base + placed + 1 - component->poly_lo[mine]];
+        }
+        backward[t] = safe_weight + mine_completion;
+        mine_weight += forward[t] * mine_completion;
+        total_weight += forward[t] * backward[t];
+        layer_max = backward[t] > layer_max ? backward[t] : layer_max;
+      }
+    }
+    marginals[i] = total_weight > 0.0 ? mine_weight / total_weight : 0.0;
+
+    size_t layer_size = 0;
+    if (component->layer_start[i + 1] > component->layer_start[i])
+    {
+      size_t last = component->layer_start[i + 1] - 1;
+      layer_size = component->poly_offset[last] + component->poly_length[last] - base;
+    }
+    for (size_t t = 0; t < layer_size && layer_max > 0.0; t++)
+    {
+      cur_weights[t] /= layer_max;
+    }
+    double *swap = cur_weights;
+    cur_weights = next_weights;
+    next_weights = swap;
+  }
+
+  free(next_weights);
+  free(cur_weights);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Computes approximate mine probabilities for a component that was too large to keep its polynomials. Every mine is
+/// weighted with the same factor, which is what the weight per mine count looks like around its typical value when
+/// many closed fields remain outside the component.
+/// @param component A solved component.
+/// @param ratio The weight of one additional mine.
+/// @param marginals Receives the mine probability per position of the component.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int computeTiltedMarginals(const myProbComponent *component, double ratio, double *marginals)
+{
+  size_t n = component->num_fields;
+  size_t num_states = component->layer_start[n + 1];
+  double *forward = calloc(num_states + 1, sizeof(double));
+  double *backward = calloc(num_states + 1, sizeof(double));
+  if (forward == NULL || backward == NULL)
+  {
+    free(forward);
+    free(backward);
+    return 1;
+  }
+
+  forward[0] = 1.0;
+  for (size_t i = 0; i < n; i++)
+  {
+    double layer_max = 0.0;
+    for (size_t s = component->layer_start[i]; s < component->layer_start[i + 1]; s++)
+    {
+      if (component->next_safe[s] != SIZE_MAX)
+      {
+        forward[component->next_safe[s]] += forward[s];
+      }
+      if (component->next_mine[s] != SIZE_MAX)
+      {
+        forward[component->next_mine[s]] += forward[s] * ratio;
+      }
+    }
+    for (size_t s = component->layer_start[i + 1]; s < component->layer_start[i + 2]; s++)
+    {
+      layer_max = forward[s] > layer_max ? forward[s] : layer_max;
+    }
+    for (size_t s = component->layer_start[i + 1]; s < component->layer_start[i + 2] && layer_max > 0.0; s++)
+    {
+      forward[s] /= layer_max;
+    }
+  }
+
+  for (size_t s = component->layer_start[n]; s < component->layer_start[n + 1]; s++)
+  {
+    backward[s] = 1.0;
+  }
+  for (size_t i = n; i-- > 0;)
+  {
+    double mine_weight = 0.0;
+    double total_weight = 0.0;
+    double layer_max = 0.0;
+    for (size_t s = component->layer_start[i]; s < component->layer_start[i + 1]; s++)
+    {
+      double safe_weight = component->next_safe[s] != SIZE_MAX ? backward[component->next_safe[s]] : 0.0;
+      double mine_completion = component->next_mine[s] != SIZE_MAX ? ratio * backward[component->next_mine[s]] : 0.0;
+      backward[s] = safe_weight + mine_completion;
+      mine_weight += forward[s] * mine_completion;
+      total_weight += forward[s] * backward[s];
+      layer_max = backward[s] > layer_max ? backward[s] : layer_max;
+    }
+    marginals[i] = total_weight > 0.0 ? mine_weight / total_weight : 0.0;
+    for (size_t s = component->layer_start[i]; s < component->layer_start[i + 1] && layer_max > 0.0; s++)
+    {
+      backward[s] /= layer_max;
+    }
+  }
+
+  free(forward);
+  free(backward);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees all memory held by the probability cache and marks it invalid.
+/// @param cache The cache to free.
+//---------------------------------------------------------------------------------------------------------------------
+void freeProbabilityCache(myProbCache *cache)
+{
+  for (size_t c = 0; c < cache->num_components; c++)
+  {
+    freeProbabilityComponent(cache->components[c]);
+  }
+  free(cache->components);
+  cache->components = NULL;
+  cache->num_components = 0;
+  freeIndexMap(&cache->component_index);
+  freeIndexMap(&cache->frontier);
+  free(cache->probabilities);
+  free(cache->approximate);
+  cache->probabilities = NULL;
+  cache->approximate = NULL;
+  cache->valid = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Looks up a solved component in the cache, or solves it and adds it to the cache.
+/// @param cache The probability cache.
+/// @param signature The signature of the component; ownership moves to the cache.
+/// @param signature_length The length of the signature.
+/// @param num_fields The number of fields of the component.
+/// @param constraints The constraints of the component, with positions as fields.
+/// @param num_constraints The number of constraints.
+/// @return The solved component, or NULL if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+myProbComponent *getProbabilityComponent(myProbCache *cache, uint64_t *signature, size_t signature_length,
+                                         size_t num_fields, const myProbConstraint *constraints, size_t num_constraints)
+{
+  uint64_t hash = 0;
+  for (size_t i = 0; i < signature_length; i++)
+  {
+    hash = mixBits(hash ^ signature[i]) + i;
+  }
+
+  size_t cached = findIndexMap(&cache->component_index, hash);
+  if (cached != SIZE_MAX && cache->components[cached]->signature_length == signature_length &&
+      memcmp(cache->components[cached]->signature, signature, signature_length * sizeof(uint64_t)) == 0)
+  {
+    free(signature);
+    cache->components[cached]->generation = cache->generation;
+    return cache->components[cached];
+  }
+
+  myProbComponent *component = calloc(1, sizeof(myProbComponent));
+  if (component == NULL)
+  {
+    free(signature);
+    return NULL;
+  }
+  component->signature = signature;
+  component->signature_length = signature_length;
+  component->hash = hash;
+  component->generation = cache->generation;
+  component->num_fields = num_fields;
+
+  // dropping states can cut off every layout; retry with more states before giving up
+  size_t max_states = PROB_MAX_STATES;
+  int solved = solveProbabilityComponent(component, constraints, num_constraints, max_states);
+  while (solved == 0 && component->pruned && component->total_length == 0 && max_states < PROB_MAX_STATES * 16)
+  {
+    clearProbabilityComponent(component);
+    max_states *= 4;
+    solved = solveProbabilityComponent(component, constraints, num_constraints, max_states);
+  }
+
+  myProbComponent **grown = realloc(cache->components, (cache->num_components + 1) * sizeof(myProbComponent *));
+  if (grown == NULL || solved != 0 || insertIndexMap(&cache->component_index, hash, cache->num_components) != 0)
+  {
+    if (grown != NULL)
+    {
+      cache->components = grown;
+    }
+    freeProbabilityComponent(component);
+    return NULL;
+  }
+  cache->components = grown;
+  cache->components[cache->num_components++] = component;
+  return component;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Removes the components which were not part of the latest query from the cache.
+/// @param cache The probability cache.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int evictProbabilityComponents(myProbCache *cache)
+{
+  size_t kept = 0;
+  for (size_t c = 0; c < cache->num_components; c++)
+  {
+    if (cache->components[c]->generation == cache->generation)
+    {
+      cache->components[kept++] = cache->components[c];
+    }
+    else
+    {
+      freeProbabilityComponent(cache->components[c]);
+    }
+  }
+  cache->num_components = kept;
+
+  freeIndexMap(&cache->component_index);
+  if (initIndexMap(&cache->component_index, kept) != 0)
+  {
+    return 1;
+  }
+  for (size_t c = 0; c < kept; c++)
+  {
+    if (insertIndexMap(&cache->component_index, cache->components[c]->hash, c) != 0)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the expected number of frontier mines if every mine in the frontier is weighted by a constant factor.
+/// @param solved The solved components.
+/// @param num_components The number of components.
+/// @param log_ratio The logarithm of the factor per mine.
+/// @return The expected number of mines in all components together.
+//---------------------------------------------------------------------------------------------------------------------
+double expectedFrontierMines(myProbComponent **solved, size_t num_components, double log_ratio)
+{
+  double expected = 0.0;
+  for (size_t c = 0; c < num_components; c++)
+  {
+    const myProbComponent *component = solved[c];
+    double max_log = -INFINITY;
+    for (size_t t = 0; t < component->total_length; t++)
+    {
+      if (component->total[t] > 0.0)
+      {
+        double value = log(component->total[t]) + (double)t * log_ratio;
+        max_log = value > max_log ? value : max_log;
+      }
+    }
+    double sum = 0.0;
+    double mines = 0.0;
+    for (size_t t = 0; t < component->total_length; t++)
+    {
+      if (component->total[t] > 0.0)
+      {
+        double weight = exp(log(component->total[t]) + (double)t * log_ratio - max_log);
+        sum += weight;
+        mines += weight * (double)(component->total_lo + t);
+      }
+    }
+    expected += sum > 0.0 ? mines / sum : 0.0;
+  }
+  return expected;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Frees the distributions and weights of all nodes of a probability tree.
+/// @param nodes The nodes of the tree.
+/// @param num_nodes The number of nodes.
+//---------------------------------------------------------------------------------------------------------------------
+void freeProbabilityTree(myProbNode *nodes, size_t num_nodes)
+{
+  for (size_t n = 0; nodes != NULL && n < num_nodes; n++)
+  {
+    free(nodes[n].product);
+    free(nodes[n].weights);
+  }
+  free(nodes);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Builds the subtree over a range of components bottom-up. Every node keeps the tilted mine count distribution of
+/// all components below it, trimmed to the counts that matter, and the range of counts its weights will be needed
+/// for.
+/// @param nodes The node storage, large enough for 2 * number of components nodes.
+/// @param num_nodes The number of nodes used so far.
+/// @param first The first component of the range.
+/// @param last One past the last component of the range.
+/// @param solved The solved components.
+/// @param tilted The tilted distribution of every component.
+/// @return Returns the index of the new node, or SIZE_MAX if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+size_t buildProbabilityTree(myProbNode *nodes, size_t *num_nodes, size_t first, size_t last,
+                            myProbComponent **solved, double **tilted)
+{
+  size_t index = (*num_nodes)++;
+  myProbNode *node = &nodes[index];
+  memset(node, 0, sizeof(myProbNode));
+  node->left = SIZE_MAX;
+  node->right = SIZE_MAX;
+  node->component = first;
+  if (last - first == 1)
+  {
+    node->lo = solved[first]->total_lo;
+    node->length = solved[first]->total_length;
+    node->product = malloc((node->length + 1) * sizeof(double));
+    if (node->product == NULL)
+    {
+      return SIZE_MAX;
+    }
+    memcpy(node->product, tilted[first], node->length * sizeof(double));
+    node->need_lo = node->lo;
+    node->need_length = node->length;
+    return index;
+  }
+
+  size_t middle = first + (last - first) / 2;
+  size_t left = buildProbabilityTree(nodes, num_nodes, first, middle, solved, tilted);
+  if (left == SIZE_MAX)
+  {
+    return SIZE_MAX;
+  }
+  size_t right = buildProbabilityTree(nodes, num_nodes, middle, last, solved, tilted);
+  if (right == SIZE_MAX)
+  {
+    return SIZE_MAX;
+  }
+  node->left = left;
+  node->right = right;
+  const myProbNode *a = &nodes[left];
+  const myProbNode *b = &nodes[right];
+  if (a->length == 0 || b->length == 0)
+  {
+    return index;
+  }
+
+  size_t length = a->length + b->length - 1;
+  node->product = calloc(length, sizeof(double));
+  if (node->product == NULL)
+  {
+    return SIZE_MAX;
+  }
+  double maximum = 0.0;
+  for (size_t s = 0; s < a->length; s++)
+  {
+    for (size_t t = 0; t < b->length; t++)
+    {
+      node->product[s + t] += a->product[s] * b->product[t];
+    }
+  }
+  for (size_t t = 0; t < length; t++)
+  {
+    maximum = node->product[t] > maximum ? node->product[t] : maximum;
+  }
+  size_t lo = 0;
+  size_t hi = length;
+  while (lo < hi && node->product[lo] <= maximum * PROB_TRIM)
+  {
+    lo++;
+  }
+  while (hi > lo && node->product[hi - 1] <= maximum * PROB_TRIM)
+  {
+    hi--;
+  }
+  for (size_t t = lo; t < hi; t++)
+  {
+    node->product[t - lo] = node->product[t] / maximum;
+  }
+  node->lo = a->lo + b->lo + lo;
+  node->length = hi - lo;
+
+  // the weights of a child are needed for its own counts combined with every count of its sibling
+  size_t need_lo = a->need_lo + b->lo;
+  size_t need_hi = a->need_lo + a->need_length + b->lo + b->length - 2;
+  size_t other_lo = b->need_lo + a->lo;
+  size_t other_hi = b->need_lo + b->need_length + a->lo + a->length - 2;
+  node->need_lo = need_lo < other_lo ? need_lo : other_lo;
+  node->need_length = (need_hi > other_hi ? need_hi : other_hi) - node->need_lo + 1;
+  return index;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Passes the weights of a node down to its children. The weight of a count below a child is the weight of that count
+/// combined with every count of the sibling, so every leaf ends up with the weights of its component summed over all
+/// other components.
+/// @param nodes The nodes of the tree.
+/// @param index The node whose weights are known.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int spreadProbabilityWeights(myProbNode *nodes, size_t index)
+{
+  myProbNode *node = &nodes[index];
+  if (node->left == SIZE_MAX)
+  {
+    return 0;
+  }
+  size_t children[2] = {node->left, node->right};
+  for (int side = 0; side < 2; side++)
+  {
+    myProbNode *child = &nodes[children[side]];
+    const myProbNode *sibling = &nodes[children[1 - side]];
+    child->weights = malloc((child->need_length + 1) * sizeof(double));
+    if (child->weights == NULL)
+    {
+      return 1;
+    }
+    double maximum = 0.0;
+    for (size_t j = 0; j < child->need_length; j++)
+    {
+      const double *parent = node->weights + (child->need_lo + j + sibling->lo - node->need_lo);
+      double sum = 0.0;
+      for (size_t t = 0; t < sibling->length; t++)
+      {
+        sum += sibling->product[t] * parent[t];
+      }
+      child->weights[j] = sum;
+      maximum = sum > maximum ? sum : maximum;
+    }
+    for (size_t j = 0; j < child->need_length && maximum > 0.0; j++)
+    {
+      child->weights[j] /= maximum;
+    }
+  }
+  free(node->weights);
+  node->weights = NULL;
+  if (spreadProbabilityWeights(nodes, node->left) != 0)
+  {
+    return 1;
+  }
+  return spreadProbabilityWeights(nodes, node->right);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Computes the mine probability of every closed field and stores it in the cache. The frontier is split into
+/// independent components (fields sharing no opened neighbour cannot influence each other), each component is
+/// enumerated on its own, and the components are combined by weighting every total number of frontier mines with the
+/// number of ways to hide the remaining mines among the closed fields away from the frontier.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param cache The probability cache to fill.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int computeMineProbabilities(myBoard *board, unsigned long long height, unsigned long long width, myProbCache *cache)
+{
+  myFrontier frontier;
+  int result = 1;
+  if (buildFrontier(board, height, width, &frontier) != 0)
+  {
+    freeFrontier(&frontier);
+    return 1;
+  }
+
+  size_t num_fields = frontier.num_fields;
+  size_t num_constraints = frontier.num_constraints;
+  unsigned long long interior = frontier.closed_fields - num_fields;
+  unsigned long long mines = frontier.hidden_mines;
+  cache->generation++;
+
+  size_t *parent = malloc((num_fields + 1) * sizeof(size_t));
+  size_t *component_of = malloc((num_fields + 1) * sizeof(size_t));
+  size_t *component_start = calloc(num_fields + 2, sizeof(size_t));
+  size_t *component_fields = malloc((num_fields + 1) * sizeof(size_t));
+  size_t *constraint_start = calloc(num_fields + 2, sizeof(size_t));
+  size_t *component_constraints = malloc((num_constraints + 1) * sizeof(size_t));
+  size_t *field_start = calloc(num_fields + 2, sizeof(size_t));
+  size_t *field_constraints = malloc((num_constraints * 8 + 1) * sizeof(size_t));
+  size_t *position = malloc((num_fields + 1) * sizeof(size_t));
+  size_t *ordered = malloc((num_fields + 1) * sizeof(size_t));
+  size_t *fill = malloc((num_fields + 2) * sizeof(size_t));
+  myProbConstraint *local = malloc((num_constraints + 1) * sizeof(myProbConstraint));
+  myProbComponent **solved = NULL;
+  double *binomial = malloc((num_fields + 1) * sizeof(double));
+  myProbNode *nodes = NULL;
+  size_t num_nodes = 0;
+  double **tilted = NULL;
+  double *weights = malloc((num_fields + 1) * sizeof(double));
+  double *marginals = malloc((num_fields + 1) * sizeof(double));
+  double *probabilities = malloc((num_fields + 1) * sizeof(double));
+  bool *approximate = malloc((num_fields + 1) * sizeof(bool));
+  size_t num_components = 0;
+
+  if (parent == NULL || component_of == NULL || component_start == NULL || component_fields == NULL ||
+      constraint_start == NULL || component_constraints == NULL || field_start == NULL || field_constraints == NULL ||
+      position == NULL || ordered == NULL || fill == NULL || local == NULL || binomial == NULL ||
+      weights == NULL || marginals == NULL || probabilities == NULL || approximate == NULL)
+  {
+    goto cleanup;
+  }
+
+  // fields sharing a constraint belong to the same component
+  for (size_t f = 0; f < num_fields; f++)
+  {
+    parent[f] = f;
+  }
+  for (size_t k = 0; k < num_constraints; k++)
+  {
+    for (int j = 1; j < frontier.constraints[k].num_fields; j++)
+    {
+      size_t a = frontier.constraints[k].fields[0];
+      size_t b = frontier.constraints[k].fields[j];
+      while (parent[a] != a)
       {
-        continue;
+        parent[a] = parent[parent[a]];
+        a = parent[a];
       }
+      while (parent[b] != b)
+      {
+        parent[b] = parent[parent[b]];
+        b = parent[b];
+      }
+      if (a != b)
+      {
+        parent[a > b ? a : b] = a < b ? a : b;
+      }
+    }
+  }
+  for (size_t f = 0; f < num_fields; f++)
+  {
+    size_t root = f;
+    while (parent[root] != root)
+    {
+      root = parent[root];
+    }
+    component_of[f] = root == f ? num_components++ : component_of[root];
+    component_start[component_of[f] + 1]++;
+  }
+  for (size_t k = 0; k < num_constraints; k++)
+  {
+    constraint_start[component_of[frontier.constraints[k].fields[0]] + 1]++;
+    for (int j = 0; j < frontier.constraints[k].num_fields; j++)
+    {
+      field_start[frontier.constraints[k].fields[j] + 1]++;
+    }
+  }
+  for (size_t c = 0; c < num_fields; c++)
+  {
+    component_start[c + 1] += component_start[c];
+    constraint_start[c + 1] += constraint_start[c];
+    field_start[c + 1] += field_start[c];
+  }
+  memcpy(fill, component_start, (num_fields + 1) * sizeof(size_t));
+  for (size_t f = 0; f < num_fields; f++)
+  {
+    component_fields[fill[component_of[f]]++] = f;
+  }
+  memcpy(fill, constraint_start, (num_fields + 1) * sizeof(size_t));
+  for (size_t k = 0; k < num_constraints; k++)
+  {
+    component_constraints[fill[component_of[frontier.constraints[k].fields[0]]]++] = k;
+  }
+  memcpy(fill, field_start, (num_fields + 1) * sizeof(size_t));
+  for (size_t k = 0; k < num_constraints; k++)
+  {
+    for (int j = 0; j < frontier.constraints[k].num_fields; j++)
+    {
+      field_constraints[fill[frontier.constraints[k].fields[j]]++] = k;
+    }
+  }
 
-      if (board[new_x][new_y].is_opened || board[new_x][new_y].is_bomb)
+  solved = calloc(num_components + 1, sizeof(myProbComponent *));
+  tilted = calloc(num_components + 1, sizeof(double *));
+  nodes = malloc((2 * num_components + 1) * sizeof(myProbNode));
+  if (solved == NULL || tilted == NULL || nodes == NULL)
+  {
+    goto cleanup;
+  }
+
+  // order every component breadth-first from its top-left field, then solve it or take it from the cache
+  for (size_t f = 0; f < num_fields; f++)
+  {
+    position[f] = SIZE_MAX;
+  }
+  for (size_t c = 0; c < num_components; c++)
+  {
+    size_t first = component_start[c];
+    size_t size = component_start[c + 1] - first;
+    size_t start = component_fields[first];
+    for (size_t f = first; f < first + size; f++)
+    {
+      if (frontier.fields[component_fields[f]] < frontier.fields[start])
       {
-        continue;
+        start = component_fields[f];
+      }
+    }
+    size_t *order = ordered + first;
+    size_t length = 0;
+    position[start] = length;
+    order[length++] = start;
+    for (size_t head = 0; head < length; head++)
+    {
+      size_t f = order[head];
+      for (size_t k = field_start[f]; k < field_start[f + 1]; k++)
+      {
+        const myProbConstraint *constraint = &frontier.constraints[field_constraints[k]];
+        for (int j = 0; j < constraint->num_fields; j++)
+        {
+          if (position[constraint->fields[j]] == SIZE_MAX)
+          {
+            position[constraint->fields[j]] = length;
+            order[length++] = constraint->fields[j];
+          }
+        }
+      }
+    }
+
+    size_t count = constraint_start[c + 1] - constraint_start[c];
+    size_t signature_length = 3 + size + count * 10;
+    uint64_t *signature = malloc(signature_length * sizeof(uint64_t));
+    if (signature == NULL)
+    {
+      goto cleanup;
+    }
+    size_t used = 0;
+    signature[used++] = width;
+    signature[used++] = size;
+    for (size_t p = 0; p < size; p++)
+    {
+      signature[used++] = frontier.fields[order[p]];
+    }
+    signature[used++] = count;
+    for (size_t k = 0; k < count; k++)
+    {
+      const myProbConstraint *constraint = &frontier.constraints[component_constraints[constraint_start[c] + k]];
+      local[k].target = constraint->target;
+      local[k].num_fields = constraint->num_fields;
+      for (int j = 0; j < constraint->num_fields; j++)
+      {
+        size_t value = position[constraint->fields[j]];
+        int slot = j;
+        while (slot > 0 && local[k].fields[slot - 1] > value)
+        {
+          local[k].fields[slot] = local[k].fields[slot - 1];
+          slot--;
+        }
+        local[k].fields[slot] = value;
+      }
+      signature[used++] = (uint64_t)(int64_t)local[k].target;
+      signature[used++] = local[k].num_fields;
+      for (int j = 0; j < local[k].num_fields; j++)
+      {
+        signature[used++] = local[k].fields[j];
+      }
+    }
+
+    solved[c] = getProbabilityComponent(cache, signature, used, size, local, count);
+    if (solved[c] == NULL)
+    {
+      goto cleanup;
+    }
+  }
+
+  // weight of every total number of frontier mines: ways to hide the rest among the interior fields, C(U, M - j).
+  // On large boards these weights fall by orders of magnitude per mine, so a constant factor per mine is moved from
+  // them into the component distributions, which keeps all products within the range of a double. The factor is the
+  // one the weights have where the tilted components expect their mines, found by bisection.
+  bool consistent = true;
+  double log_ratio = 0.0;
+  {
+    double low = -64.0;
+    double high = 64.0;
+    for (int step = 0; step < 64; step++)
+    {
+      log_ratio = (low + high) / 2.0;
+      double expected = expectedFrontierMines(solved, num_components, log_ratio);
+      double above = (double)mines - expected;
+      double below = (double)interior - (double)mines + expected + 1.0;
+      double local = above <= 0.0 ? -INFINITY : (below <= 0.0 ? INFINITY : log(above) - log(below));
+      if (log_ratio > local)
+      {
+        high = log_ratio;
+      }
+      else
+      {
+        low = log_ratio;
+      }
+    }
+
+    size_t j0 = mines > interior ? (size_t)(mines - interior) : 0;
+    double log_weight = 0.0;
+    for (size_t j = 0; j <= num_fields; j++)
+    {
+      binomial[j] = -INFINITY;
+      if (j >= j0 && j <= mines)
+      {
+        binomial[j] = log_weight - (double)j * log_ratio;
+        if (j < mines)
+        {
+          log_weight += log((double)(mines - j)) - log((double)(interior - mines + j + 1));
+        }
+      }
+    }
+
+    for (size_t c = 0; c < num_components; c++)
+    {
+      const myProbComponent *component = solved[c];
+      tilted[c] = malloc((component->total_length + 1) * sizeof(double));
+      if (tilted[c] == NULL)
+      {
+        goto cleanup;
+      }
+      double max_tilted = -INFINITY;
+      for (size_t t = 0; t < component->total_length; t++)
+      {
+        tilted[c][t] = component->total[t] > 0.0
+                           ? log(component->total[t]) + (double)(component->total_lo + t) * log_ratio
+                           : -INFINITY;
+        max_tilted = tilted[c][t] > max_tilted ? tilted[c][t] : max_tilted;
+      }
+      for (size_t t = 0; t < component->total_length; t++)
+      {
+        tilted[c][t] = isinf(tilted[c][t]) ? 0.0 : exp(tilted[c][t] - max_tilted);
+      }
+    }
+  }
+
+  // combine the components in a balanced tree: products of the distributions go up, weights come back down
+  double interior_probability = 0.0;
+  double total_weight = num_components == 0 && !isinf(binomial[0]) ? 1.0 : 0.0;
+  double interior_mines = total_weight * (double)mines;
+  if (num_components > 0)
+  {
+    size_t root = buildProbabilityTree(nodes, &num_nodes, 0, num_components, solved, tilted);
+    if (root == SIZE_MAX)
+    {
+      goto cleanup;
+    }
+    myProbNode *top = &nodes[root];
+    top->weights = malloc((top->need_length + 1) * sizeof(double));
+    if (top->weights == NULL)
+    {
+      goto cleanup;
+    }
+    double max_log = -INFINITY;
+    for (size_t j = 0; j < top->need_length; j++)
+    {
+      max_log = binomial[top->need_lo + j] > max_log ? binomial[top->need_lo + j] : max_log;
+    }
+    for (size_t j = 0; j < top->need_length; j++)
+    {
+      top->weights[j] = isinf(max_log) || isinf(binomial[top->need_lo + j]) ? 0.0
+                                                                             : exp(binomial[top->need_lo + j] - max_log);
+    }
+    for (size_t t = 0; t < top->length; t++)
+    {
+      size_t count = top->lo + t;
+      double weight = top->product[t] * top->weights[count - top->need_lo];
+      total_weight += weight;
+      interior_mines += count <= mines ? weight * (double)(mines - count) : 0.0;
+    }
+    if (total_weight > 0.0 && spreadProbabilityWeights(nodes, root) != 0)
+    {
+      goto cleanup;
+    }
+  }
+  consistent = total_weight > 0.0;
+
+  for (size_t n = 0; consistent && n < num_nodes; n++)
+  {
+    if (nodes[n].left != SIZE_MAX)
+    {
+      continue;
+    }
+    size_t c = nodes[n].component;
+    size_t first = component_start[c];
+    size_t size = component_start[c + 1] - first;
+    myProbComponent *component = solved[c];
+
+    // the weights come out tilted like the distributions; undo that for this component
+    double maximum = -INFINITY;
+    for (size_t k = 0; k <= size; k++)
+    {
+      double sum = k >= nodes[n].need_lo && k - nodes[n].need_lo < nodes[n].need_length
+                       ? nodes[n].weights[k - nodes[n].need_lo]
+                       : 0.0;
+      weights[k] = sum > 0.0 ? log(sum) + (double)k * log_ratio : -INFINITY;
+      maximum = weights[k] > maximum ? weights[k] : maximum;
+    }
+    for (size_t k = 0; k <= size; k++)
+    {
+      weights[k] = isinf(weights[k]) ? 0.0 : exp(weights[k] - maximum);
+    }
+
+    double component_weight = 0.0;
+    double expected_mines = 0.0;
+    for (size_t t = 0; t < component->total_length; t++)
+    {
+      double weight = component->total[t] * weights[component->total_lo + t];
+      component_weight += weight;
+      expected_mines += weight * (double)(component->total_lo + t);
+    }
+    if (component_weight <= 0.0)
+    {
+      consistent = false;
+      break;
+    }
+
+    if (component->exact)
+    {
+      if (computeExactMarginals(component, weights, marginals) != 0)
+      {
+        goto cleanup;
+      }
+    }
+    else
+    {
+      size_t k = (size_t)(expected_mines / component_weight);
+      k = k + 1 > size ? (size > 0 ? size - 1 : 0) : k;
+      double ratio = weights[k] > 0.0 && weights[k + 1] > 0.0 ? weights[k + 1] / weights[k] : 1.0;
+      if (computeTiltedMarginals(component, ratio, marginals) != 0)
+      {
+        goto cleanup;
       }
-      openField(board, new_x, new_y, height, width, remaining_flags);
     }
+    for (size_t p = 0; p < size; p++)
+    {
+      probabilities[ordered[first + p]] = marginals[p];
+      approximate[ordered[first + p]] = !component->exact || component->pruned;
+    }
+  }
+
+  // fields away from the frontier share the expected number of remaining mines
+  if (consistent && interior > 0)
+  {
+    interior_probability = interior_mines / total_weight / (double)interior;
+  }
+
+  freeIndexMap(&cache->frontier);
+  free(cache->probabilities);
+  free(cache->approximate);
+  cache->frontier = frontier.index;
+  frontier.index.keys = NULL;
+  frontier.index.values = NULL;
+  frontier.index.capacity = 0;
+  cache->probabilities = probabilities;
+  cache->approximate = approximate;
+  probabilities = NULL;
+  approximate = NULL;
+  cache->interior_probability = interior_probability;
+  cache->consistent = consistent;
+  cache->valid = true;
+  result = evictProbabilityComponents(cache);
+
+cleanup:
+  for (size_t c = 0; tilted != NULL && c < num_components; c++)
+  {
+    free(tilted[c]);
+  }
+  free(tilted);
+  freeProbabilityTree(nodes, num_nodes);
+  free(parent);
+  free(component_of);
+  free(component_start);
+  free(component_fields);
+  free(constraint_start);
+  free(component_constraints);
+  free(field_start);
+  free(field_constraints);
+  free(position);
+  free(ordered);
+  free(fill);
+  free(local);
+  free(solved);
+  free(binomial);
+  free(weights);
+  free(marginals);
+  free(probabilities);
+  free(approximate);
+  freeFrontier(&frontier);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the cached mine probability of a field.
+/// @param board A myBoard structure representing the game board.
+/// @param row The row index of the field.
+/// @param col The column index of the field.
+/// @param width The width of the game board.
+/// @param cache A valid probability cache.
+/// @param approximate Set to true if the probability is approximate; may be NULL.
+/// @return The probability that the field hides a mine.
+//---------------------------------------------------------------------------------------------------------------------
+double probabilityOfField(myBoard *board, unsigned long long row, unsigned long long col, unsigned long long width,
+                          const myProbCache *cache, bool *approximate)
+{
+  if (approximate != NULL)
+  {
+    *approximate = false;
+  }
+  if (readBoardField(board, row, col).is_opened)
+  {
+    return readBoardField(board, row, col).is_bomb ? 1.0 : 0.0;
+  }
+  size_t field = findIndexMap(&cache->frontier, row * width + col);
+  if (field == SIZE_MAX)
+  {
+    return cache->interior_probability;
   }
+  if (approximate != NULL)
+  {
+    *approximate = cache->approximate[field];
+  }
+  return cache->probabilities[field];
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the current state of the game board to the console, showing opened fields, flagged fields, and closed fields.
-/// @param board A 2D array of myField structures representing the game board.
+/// Prints the game board with the mine probability of every closed field: a cyan digit for every started 10 percent
+/// (0 means below 10 percent), so it cannot be mistaken for the number of an opened field, and a mine for fields which
+/// certainly hide one.
+/// @param board A myBoard structure representing the game board.
 /// @param height The height of the game board.
 /// @param width The width of the game board.
+/// @param flags_left The number of flags left for the player to use.
+/// @param cache A valid probability cache.
 //---------------------------------------------------------------------------------------------------------------------
-void printField(myField **board, unsigned long long height, unsigned long long width)
+void printProbabilityMap(myBoard *board, unsigned long long height, unsigned long long width, long long flags_left,
+                         const myProbCache *cache)
 {
+  if (render_suppressed)
+  {
+    return;
+  }
+  printFlagsLeft(flags_left);
+  printHorizontalBorder(width);
   for (unsigned long long i = 0; i < height; i++)
   {
-    printf("%s", EMPTY_SPACE);
-    printf("%c", VERTICAL_BORDER);
+    RENDER_PRINTF("%s", EMPTY_SPACE);
+    RENDER_PRINTF("%c", VERTICAL_BORDER);
     for (unsigned long long j = 0; j < width; j++)
     {
-      if (board[i][j].is_flagged == true)
+      if (readBoardField(board, i, j).is_opened)
       {
-        printf(FLAGERRED_FIELD_COLOR "¶" RESET_TEXT);
-      }
-      else if (board[i][j].is_opened)
-      {
-        if (board[i][j].is_bomb)
+        if (readBoardField(board, i, j).is_bomb)
         {
-          printf(MINE_NORMAL_COLOR "@" RESET_TEXT);
+          RENDER_PRINTF(MINE_NORMAL_COLOR "@" RESET_TEXT);
         }
         else
         {
-          board[i][j].adjacent_bombs = countAdjacentBombs(board, i, j, height, width);
-          if (board[i][j].adjacent_bombs == 0)
+          int adjacent_bombs = countAdjacentBombs(board, i, j, height, width);
+          cacheAdjacentBombs(board, i, j, adjacent_bombs);
+          if (adjacent_bombs == 0)
           {
-            printf("·");
+            RENDER_PRINTF("·");
           }
           else
           {
-            printf("%d", board[i][j].adjacent_bombs);
+            RENDER_PRINTF("%d", adjacent_bombs);
           }
         }
+        continue;
+      }
+
+      double probability = probabilityOfField(board, i, j, width, cache, NULL);
+      if (probability >= 1.0 - 1e-9)
+      {
+        RENDER_PRINTF(MINE_NORMAL_COLOR "@" RESET_TEXT);
       }
       else
       {
-        printClosedField();
+        int tenth = (int)(probability * 10.0);
+        RENDER_PRINTF(PROBABILITY_COLOR "%d" RESET_TEXT, tenth > 9 ? 9 : tenth);
       }
     }
-    printf("%c", VERTICAL_BORDER);
-    printf("\n");
+    RENDER_PRINTF("%c", VERTICAL_BORDER);
+    RENDER_PRINTF("\n");
   }
+  printHorizontalBorder(width);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints only the opened fields of the game board, showing bombs and the number of adjacent bombs for each field.
-/// @param board A 2D array of myField structures representing the game board.
+/// Handles the "prob" and "probmap" commands. "prob" prints the mine probability of a single field, "probmap" prints
+/// the whole board with probabilities. Results are cached until the board changes.
+/// @param board A myBoard structure representing the game board.
 /// @param height The height of the game board.
 /// @param width The width of the game board.
+/// @param i The number of arguments passed to the command.
+/// @param remaining_flags The number of flags remaining for the player to use.
+/// @param words An array of strings containing the command arguments.
+/// @param cache The probability cache.
 //---------------------------------------------------------------------------------------------------------------------
-void printOpenedField(myField **board, unsigned long long height, unsigned long long width)
+void handleProbCommand(myBoard *board, unsigned long long height, unsigned long long width, int i,
+                       long long remaining_flags, char **words, myProbCache *cache)
 {
-  for (unsigned long long i = 0; i < height; i++)
+  bool single_field = strcmp(words[0], "prob") == 0;
+  unsigned long long row = 0;
+  unsigned long long col = 0;
+
+  if (single_field)
   {
-    printf("%s", EMPTY_SPACE);
-    printf("%c", VERTICAL_BORDER);
-    for (unsigned long long j = 0; j < width; j++)
+    if (i < 3)
     {
-      if (board[i][j].is_bomb)
-      {
-        printf(MINE_NORMAL_COLOR "@" RESET_TEXT);
-      }
-      else
-      {
-        board[i][j].adjacent_bombs = countAdjacentBombs(board, i, j, height, width);
-        if (board[i][j].adjacent_bombs == 0)
-        {
-          printf("·");
-        }
-        else
-        {
-          printf("%d", board[i][j].adjacent_bombs);
-        }
-      }
+      printf(COMMAND_MISSING_ARGUMENTS);
+      return;
     }
-    printf("%c", VERTICAL_BORDER);
-    printf("\n");
+    else if (i > 3)
+    {
+      printf(TOO_MANY_ARGUMENTS);
+      return;
+    }
+    int row_result = parseBoundedNumber(words[1], height, &row);
+    int col_result = parseBoundedNumber(words[2], width, &col);
+    if (row_result == 1 || col_result == 1)
+    {
+      printf(INVALID_ARGUMENTS);
+      return;
+    }
+    if (row_result != 0 || col_result != 0)
+    {
+      printf(INVALID_COORDINATES);
+      return;
+    }
+  }
+
+  if (!cache->valid && computeMineProbabilities(board, height, width, cache) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    return;
+  }
+  if (!cache->consistent)
+  {
+    printf(NO_MATCHING_LAYOUT);
+    return;
+  }
+
+  if (single_field)
+  {
+    bool approximate = false;
+    double probability = probabilityOfField(board, row, col, width, cache, &approximate);
+    printf("Mine probability of field %llu %llu: %.6f%s\n", row, col, probability, approximate ? " (approximate)" : "");
+  }
+  else
+  {
+    printProbabilityMap(board, height, width, remaining_flags, cache);
   }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the entire game map including the number of flags left, a horizontal border, and the current state of the game board.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param flags_left The number of flags left for the player to use.
+/// Returns the current time of the monotonic clock.
+/// @return The time in nanoseconds.
 //---------------------------------------------------------------------------------------------------------------------
-void printMap(myField **board, unsigned long long height, unsigned long long width, int flags_left)
+unsigned long long nowNanoseconds()
 {
-  printFlagsLeft(flags_left);
-  printHorizontalBorder(width);
-  printField(board, height, width);
-  printHorizontalBorder(width);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the map with only opened fields visible, including the number of flags left and a horizontal border.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param flags_left The number of flags left for the player to use.
+/// Looks up a command by its name, switching on the first character so that at most one name is compared.
+/// @param word The first word of a command line.
+/// @return One of the COMMAND_ constants, which is also the index into stats_command_names.
 //---------------------------------------------------------------------------------------------------------------------
-void printOpenedMap(myField **board, unsigned long long height, unsigned long long width, int flags_left)
+int parseCommandName(const char *word)
 {
-  printFlagsLeft(flags_left);
-  printHorizontalBorder(width);
-  printOpenedField(board, height, width);
-  printHorizontalBorder(width);
+  int command = COMMAND_UNKNOWN;
+  switch (word[0])
+  {
+    case 's':
+      command = word[1] == 't' ? (word[2] == 'a' && word[3] == 'r' ? COMMAND_START : COMMAND_STATS) : COMMAND_SAVE;
+      break;
+    case 'o':
+      command = COMMAND_OPEN;
+      break;
+    case 'f':
+      command = COMMAND_FLAG;
+      break;
+    case 'd':
+      command = COMMAND_DUMP;
+      break;
+    case 'l':
+      command = COMMAND_LOAD;
+      break;
+    case 'q':
+      command = COMMAND_QUIT;
+      break;
+    case 'u':
+      command = COMMAND_UNDO;
+      break;
+    case 'r':
+      command = word[1] == 'e' && word[2] == 'g' ? COMMAND_REGION : COMMAND_REDO;
+      break;
+    case 'e':
+      command = COMMAND_EXPORT;
+      break;
+    case 'p':
+      command = word[1] == 'r' && word[2] == 'o' && word[3] == 'b' && word[4] == 'm' ? COMMAND_PROBMAP : COMMAND_PROB;
+      break;
+    default:
+      return COMMAND_UNKNOWN;
+  }
+  return strcmp(word, stats_command_names[command]) == 0 ? command : COMMAND_UNKNOWN;
+}
+
+#ifndef A4_NO_STATS
+//---------------------------------------------------------------------------------------------------------------------
+/// Adds the duration of a command to its statistics.
+/// @param command The command, one of the COMMAND_ constants.
+/// @param begin The time the command started, from nowNanoseconds().
+//---------------------------------------------------------------------------------------------------------------------
+void recordCommand(int command, unsigned long long begin)
+{
+  unsigned long long duration = nowNanoseconds() - begin;
+  myCommandStats *stats = &game_stats.commands[command];
+  stats->count++;
+  stats->total_ns += duration;
+  stats->max_ns = duration > stats->max_ns ? duration : stats->max_ns;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Removes the newline character from a string by replacing it with a null terminator.
-/// @param string The string from which the newline character will be removed.
+/// Prints the counters and the latency of every command used so far.
 //---------------------------------------------------------------------------------------------------------------------
-void removeNewLine(char string[])
+void printStats()
 {
-  while (*string != '\0')
+  printf("Flood fill fields: %llu\n", game_stats.flood_fill_fields);
+  printf("Adjacent mine counts: %llu\n", game_stats.adjacent_counts);
+  printf("Bytes rendered: %llu\n", game_stats.bytes_rendered);
+  printf("Random numbers drawn: %llu\n", game_stats.random_numbers);
+  printf("Saved: %llu bytes in %.3f ms\n", game_stats.saved_bytes, game_stats.save_ns / 1e6);
+  printf("Loaded: %llu bytes in %.3f ms\n", game_stats.loaded_bytes, game_stats.load_ns / 1e6);
+  printf("Boards: %llu allocated, %llu reused, %llu bytes, peak %llu bytes\n", game_stats.board_allocations,
+         game_stats.board_reuses, game_stats.board_bytes, game_stats.board_peak_bytes);
+  printf("%-10s %8s %12s %12s %12s\n", "Command", "Count", "Total ms", "Mean us", "Max us");
+  for (int c = 0; c < STATS_COMMANDS; c++)
   {
-    if (*string == '\n')
+    const myCommandStats *stats = &game_stats.commands[c];
+    if (stats->count > 0)
     {
-      *string = '\0';
+      printf("%-10s %8llu %12.3f %12.1f %12.1f\n", stats_command_names[c], stats->count, stats->total_ns / 1e6,
+             stats->total_ns / 1e3 / stats->count, stats->max_ns / 1e3);
     }
-    string++;
   }
 }
+#else
+#define recordCommand(command, begin) ((void)(command), (void)(begin))
+#define printStats() printf(STATS_UNAVAILABLE)
+#endif
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the initial welcome message and game settings including field size and number of mines.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param count The number of mines to be placed on the game board.
+/// Frees the board and the probability cache of a game and closes its trace.
+/// @param game The game to free.
 //---------------------------------------------------------------------------------------------------------------------
-void printInitialMessage(unsigned long long height, unsigned long long width, int count)
+void freeGame(myGame *game)
 {
-  printf("Welcome to ESP Minesweeper!\n");
-  printf("Chosen field size: %llu x %llu.\n", height, width);
-  printf("After map generation %d mines will be hidden in the playing field.\n", count);
+  if (game->board != NULL)
+  {
+    freeMemoryBoard(game->board);
+    game->board = NULL;
+  }
+  freeProbabilityCache(&game->prob_cache);
+  freeHistory(&game->history);
+  if (game->trace != NULL)
+  {
+    fclose(game->trace);
+    game->trace = NULL;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Writes a number to a trace as a variable-length integer: seven bits per byte, lowest first, the highest bit set on
+/// all but the last byte.
+/// @param file The trace.
+/// @param value The number to write.
+/// @return Returns 0 on success or 1 if writing fails.
+//---------------------------------------------------------------------------------------------------------------------
+int writeTraceNumber(FILE *file, unsigned long long value)
+{
+  do
+  {
+    int byte = value & 0x7f;
+    value >>= 7;
+    if (fputc(value != 0 ? byte | 0x80 : byte, file) == EOF)
+    {
+      return 1;
+    }
+  } while (value != 0);
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Clears the input buffer to prevent unwanted characters from affecting subsequent inputs.
+/// Reads a variable-length integer written by writeTraceNumber().
+/// @param file The trace.
+/// @param value Pointer to store the number.
+/// @return Returns 0 on success, 1 if the trace ends before the number, or 2 if the number is cut off or too long.
 //---------------------------------------------------------------------------------------------------------------------
-void clearInputBuffer()
+int readTraceNumber(FILE *file, unsigned long long *value)
 {
-  int c;
-  while ((c = getchar()) != '\n' && c != EOF)
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
   {
+    int byte = fgetc(file);
+    if (byte == EOF)
+    {
+      return shift == 0 ? 1 : 2;
+    }
+    *value |= (unsigned long long)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      return 0;
+    }
   }
+  return 2;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Toggles the flag status of a field on the game board, either adding or removing a flag based on its current state.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param i The row index of the field to toggle.
-/// @param j The column index of the field to toggle.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
+/// Creates the trace of a game and writes its header: the magic number "ESPT", the version and the flags (one byte
+/// each), the height, the width and the number of mines (64 bits each) and the seed (32 bits), all in the byte order of
+/// the machine like the save files.
+/// @param game The game; its trace_file names the trace.
+/// @return Returns 0 on success or 1 if the trace cannot be written.
 //---------------------------------------------------------------------------------------------------------------------
-void fieldFlag(myField **board, int i, int j, int *remaining_flags)
+int createTrace(myGame *game)
 {
-  if (board[i][j].is_flagged == true)
+  game->trace = fopen(game->trace_file, "wb");
+  if (game->trace == NULL)
   {
-    board[i][j].is_flagged = false;
-    (*remaining_flags)++;
+    printf(FAILED_TO_OPEN_FILE);
+    return 1;
   }
-  else if (board[i][j].is_flagged == false && board[i][j].is_opened == false)
+
+  uint8_t version = TRACE_VERSION;
+  uint8_t flags = (game->no_guess ? TRACE_NO_GUESS : 0) | (game->procedural ? TRACE_PROCEDURAL : 0);
+  uint64_t height = game->height;
+  uint64_t width = game->width;
+  uint64_t count = game->count;
+  int32_t seed = game->seed;
+  if (fwrite(TRACE_MAGIC, 4, 1, game->trace) != 1 || fwrite(&version, 1, 1, game->trace) != 1 ||
+      fwrite(&flags, 1, 1, game->trace) != 1 || fwrite(&height, sizeof(height), 1, game->trace) != 1 ||
+      fwrite(&width, sizeof(width), 1, game->trace) != 1 || fwrite(&count, sizeof(count), 1, game->trace) != 1 ||
+      fwrite(&seed, sizeof(seed), 1, game->trace) != 1 || fflush(game->trace) != 0)
   {
-    board[i][j].is_flagged = true;
-    (*remaining_flags)--;
+    printf(FAILED_TO_OPEN_FILE);
+    fclose(game->trace);
+    game->trace = NULL;
+    return 1;
   }
+  game->trace_ns = nowNanoseconds();
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Checks if the win condition is met by verifying all non-bomb fields are opened.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return Returns 0 if the win condition is met, otherwise returns 1.
+/// Appends a command to the trace of a game: the nanoseconds since the previous command (or the header) and the length
+/// of the line as variable-length integers, followed by the line without its newline. The trace is flushed so it is
+/// complete even if the game is killed.
+/// @param game The game with an open trace.
+/// @param line The command line as read from the input.
 //---------------------------------------------------------------------------------------------------------------------
-int checkWinCondition(myField **board, unsigned long long height, unsigned long long width)
+void recordTraceCommand(myGame *game, const char *line)
 {
-  for (unsigned long long i = 0; i < height; i++)
+  unsigned long long now = nowNanoseconds();
+  size_t length = strlen(line);
+  if (writeTraceNumber(game->trace, now - game->trace_ns) != 0 || writeTraceNumber(game->trace, length) != 0 ||
+      fwrite(line, 1, length, game->trace) != length || fflush(game->trace) != 0)
   {
-    for (unsigned long long j = 0; j < width; j++)
-    {
-      if (board[i][j].is_opened == false && board[i][j].is_bomb == false)
-      {
-        return 1;
-      }
-    }
+    // a broken trace is not worth ending the game for; recording just stops
+    fclose(game->trace);
+    game->trace = NULL;
+    return;
   }
-  return 0;
+  game->trace_ns = now;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Prints the game board in a special format when the player wins, showing all bombs and opened fields.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
+/// Opens a trace for replaying and takes the board size, the number of mines, the seed and the no-guess and procedural
+/// settings of the recorded game from its header.
+/// @param game The game; its replay_file names the trace.
+/// @return Returns the trace positioned at the first command, or NULL if it cannot be opened or has no valid header.
 //---------------------------------------------------------------------------------------------------------------------
-void printWonField(myField **board, unsigned long long height, unsigned long long width)
+FILE *openReplayTrace(myGame *game)
 {
-  for (unsigned long long i = 0; i < height; i++)
+  FILE *file = fopen(game->replay_file, "rb");
+  if (file == NULL)
   {
-    printf("%s", EMPTY_SPACE);
-    printf("%c", VERTICAL_BORDER);
-    for (unsigned long long j = 0; j < width; j++)
-    {
-      if (board[i][j].is_bomb == true)
-      {
-        printf(MINE_NORMAL_COLOR "@" RESET_TEXT);
-      }
-      else if (board[i][j].is_opened == true && board[i][j].is_bomb == false)
-      {
-        board[i][j].adjacent_bombs = countAdjacentBombs(board, i, j, height, width);
-        if (board[i][j].adjacent_bombs == 0)
-        {
-          printf("·");
-        }
-        else
-        {
-          printf("%d", board[i][j].adjacent_bombs);
-        }
-      }
-    }
-    printf("%c", VERTICAL_BORDER);
-    printf("\n");
+    printf(FAILED_TO_OPEN_FILE);
+    return NULL;
   }
-}
-//---------------------------------------------------------------------------------------------------------------------
-/// Prints the game board in a special format when the player wins, showing all bombs and opened fields.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param remaining_flags The number of flags left for the player to use.
-//---------------------------------------------------------------------------------------------------------------------
-void printWonMap(myField **board, unsigned long long height, unsigned long long width, int remaining_flags)
-{
-  printFlagsLeft(remaining_flags);
-  printHorizontalBorder(width);
-  printWonField(board, height, width);
-  printHorizontalBorder(width);
+
+  char magic[4];
+  uint8_t version;
+  uint8_t flags;
+  uint64_t height;
+  uint64_t width;
+  uint64_t count;
+  int32_t seed;
+  if (fread(magic, 4, 1, file) != 1 || fread(&version, 1, 1, file) != 1 || fread(&flags, 1, 1, file) != 1 ||
+      fread(&height, sizeof(height), 1, file) != 1 || fread(&width, sizeof(width), 1, file) != 1 ||
+      fread(&count, sizeof(count), 1, file) != 1 || fread(&seed, sizeof(seed), 1, file) != 1 ||
+      memcmp(magic, TRACE_MAGIC, 4) != 0 || version != TRACE_VERSION || height == 0 || width == 0 || count == 0 ||
+      seed < 0)
+  {
+    printf(INVALID_FILE_CONTENT);
+    fclose(file);
+    return NULL;
+  }
+
+  game->height = height;
+  game->width = width;
+  game->count = count;
+  game->seed = seed;
+  game->no_guess = (flags & TRACE_NO_GUESS) != 0;
+  game->procedural = (flags & TRACE_PROCEDURAL) != 0;
+  game->engine = findBoardEngine(height, width);
+  return file;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Handles the "start" command by initializing the game board, placing mines, and opening the starting field.
-/// @param board A pointer to the game board, a 2D array of myField structures.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param count The total number of mines to place on the board.
-/// @param i The number of arguments passed to the command.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
-/// @param seed The seed value used for random number generation.
-/// @param words An array of strings containing the command arguments.
-/// @return Returns 0 if the game continues, 1 for invalid command usage, and 2 if the player loses by opening a bomb.
+/// Reads the next command of a trace.
+/// @param file The trace.
+/// @param line Pointer to the buffer for the command line, which grows as needed.
+/// @param capacity Pointer to the size of the buffer.
+/// @param delay Pointer to store the nanoseconds between the previous command and this one while recording.
+/// @return Returns 0 if a command was read, 1 at the end of the trace, 2 if the command is cut off, or 3 if memory
+///         allocation fails.
 //---------------------------------------------------------------------------------------------------------------------
-int handleStartCommand(myField **board, unsigned long long height, unsigned long long width, int count, int i, int *remaining_flags, int seed, char **words)
+int readTraceCommand(FILE *file, char **line, size_t *capacity, unsigned long long *delay)
 {
-  if (i < 3)
+  unsigned long long length;
+  int result = readTraceNumber(file, delay);
+  if (result != 0)
   {
-    printf(COMMAND_MISSING_ARGUMENTS);
-    return 1;
+    return result;
   }
-  else if (i > 3)
+  if (readTraceNumber(file, &length) != 0 || length >= SIZE_MAX)
   {
-    printf(TOO_MANY_ARGUMENTS);
-    return 1;
+    return 2;
   }
-  else
+  if (reserveArray((void **)line, capacity, length + 1, 1) != 0)
+  {
+    return 3;
+  }
+  if (fread(*line, 1, length, file) != length)
+  {
+    return 2;
+  }
+  (*line)[length] = '\0';
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Reads the next line of the input. The input is read in large blocks into a buffer which is kept for all lines, so
+/// reading a line does not allocate memory unless it is longer than all lines before. Pending output is flushed
+/// before waiting for input, so the prompt is visible.
+/// @param reader The reader of the input.
+/// @param line Pointer to store the line; its newline is replaced by a null character. It stays valid until the
+///        next call.
+/// @return Returns 0 if a line was read, 1 at the end of the input, 2 if memory allocation fails, 3 if the input
+///         does not block and has no complete line yet, or 4 if the line is longer than the max_line of the reader.
+//---------------------------------------------------------------------------------------------------------------------
+int readCommandLine(myLineReader *reader, char **line)
+{
+  while (1)
   {
-    if (!isInteger(words[1]) || !isInteger(words[2]))
+    char *begin = reader->buffer + reader->start;
+    size_t unsearched = reader->end - reader->start - reader->searched;
+    char *newline = unsearched > 0 ? memchr(begin + reader->searched, '\n', unsearched) : NULL;
+    if (newline != NULL || (reader->end_of_input && reader->start < reader->end))
     {
-      printf(INVALID_ARGUMENTS);
-      return 1;
+      size_t length = newline != NULL ? (size_t)(newline - begin) : reader->end - reader->start;
+      begin[length] = '\0'; // the buffer always has room for one more character
+      *line = begin;
+      reader->start += newline != NULL ? length + 1 : length;
+      reader->searched = 0;
+      return 0;
     }
-    int x = atoi(words[1]);
-    int y = atoi(words[2]);
-
-    if (x >= height || y >= width)
+    if (reader->end_of_input)
     {
-      printf(INVALID_COORDINATES);
       return 1;
     }
 
-    *remaining_flags = count;
-    int starting_field = x * width + y;
-
-    generateMap(board, height, width, count, starting_field, &seed);
-
-    int flag_bombica = openField(board, x, y, height, width, remaining_flags);
-
-    if (flag_bombica != 0)
+    reader->searched = reader->end - reader->start;
+    if (reader->max_line > 0 && reader->searched > reader->max_line)
+    {
+      return 4;
+    }
+    if (reader->start > 0)
+    {
+      memmove(reader->buffer, begin, reader->searched);
+      reader->start = 0;
+      reader->end = reader->searched;
+    }
+    if (reserveArray((void **)&reader->buffer, &reader->capacity, reader->end + LINE_READ_SIZE + 1, 1) != 0)
     {
-      printf("=== You lost! ===\n");
-      printLostMap(board, x, y, height, width, *remaining_flags);
-      freeMemoryBoard(board, height);
       return 2;
     }
 
-    printMap(board, height, width, *remaining_flags);
+    fflush(stdout);
+    ssize_t bytes = read(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end - 1);
+    if (bytes > 0)
+    {
+      reader->end += bytes;
+    }
+    else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      return 3;
+    }
+    else if (bytes == 0 || errno != EINTR)
+    {
+      reader->end_of_input = true;
+    }
   }
-  return 1;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Handles the "open" command by opening a specified field on the game board. It checks for command validity, parses
-/// coordinates, and manages game state changes such as flag removal, bomb opening, win condition, and map printing.
-/// @param board A pointer to the game board, a 2D array of myField structures.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param i The number of arguments passed to the command.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
-/// @param words An array of strings containing the command arguments.
-/// @return Returns 1 for continued gameplay, 0 for game over, and 1 for invalid command usage.
+/// Splits a command line into words in a single pass. Words are separated by spaces; the first space after every word
+/// is overwritten with a null character, so the words point into the line.
+/// @param line The command line without its newline.
+/// @param words Array to store the words in.
+/// @return The number of words; lines with more than COMMAND_MAX_WORDS words count as COMMAND_MAX_WORDS words, and
+///         only the first COMMAND_MAX_WORDS - 1 words are terminated.
 //---------------------------------------------------------------------------------------------------------------------
-int handleOpenCommand(myField **board, unsigned long long height, unsigned long long width, int i, int *remaining_flags, char **words)
+int splitCommandLine(char *line, char *words[COMMAND_MAX_WORDS])
 {
-  if (i < 3)
-  {
-    printf(COMMAND_MISSING_ARGUMENTS);
-    return 1;
-  }
-  else if (i > 3)
-  {
-    printf(TOO_MANY_ARGUMENTS);
-    return 1;
-  }
-  else
+  int num_words = 0;
+  while (*line != '\0')
   {
-    if (!isInteger(words[1]) || !isInteger(words[2]))
+    if (*line == ' ')
     {
-      printf(INVALID_ARGUMENTS);
-      return 1;
-    }
-    int x = atoi(words[1]);
-    int y = atoi(words[2]);
-
-    if (x >= height || y >= width)
-    {
-      printf(INVALID_COORDINATES);
-      return 1;
+      line++;
+      continue;
     }
-
-    if (board[x][y].is_flagged)
+    if (num_words == COMMAND_MAX_WORDS - 1)
     {
-      if (!board[x][y].is_bomb)
-      {
-        (*remaining_flags)++;
-      }
-      board[x][y].is_flagged = false;
+      words[num_words] = line;
+      return COMMAND_MAX_WORDS;
     }
-
-    int bomb = openField(board, x, y, height, width, remaining_flags);
-    if (bomb != 0)
+    words[num_words++] = line;
+    while (*line != '\0' && *line != ' ')
     {
-      printf("=== You lost! ===\n\n");
-      printLostMap(board, x, y, height, width, *remaining_flags);
-      freeMemoryBoard(board, height);
-      return 0;
+      line++;
     }
-
-    int win = checkWinCondition(board, height, width);
-    if (win == 0)
+    if (*line == ' ')
     {
-      printf("=== You won! ===\n\n");
-      printWonMap(board, height, width, *remaining_flags);
-      freeMemoryBoard(board, height);
-      return 0;
+      *line++ = '\0';
     }
-    printMap(board, height, width, *remaining_flags);
   }
-  return 1;
+  return num_words;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Handles the "flag" command by toggling the flag status of a specified field on the game board. It validates the
-/// command arguments, checks for valid coordinates, and updates the game state accordingly.
-/// @param board A pointer to the game board, a 2D array of myField structures.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @param i The number of arguments passed to the command.
-/// @param remaining_flags A pointer to the number of flags remaining for the player to use.
-/// @param words An array of strings containing the command arguments.
+/// Executes one command line of the game.
+/// @param game The game the command applies to.
+/// @param line The command line without its newline; it is split into words in place.
+/// @param command Pointer to store the command, one of the COMMAND_ constants, or NULL.
+/// @return Returns GAME_CONTINUE if the game goes on, otherwise the exit code of the game: 0 when the game is won, lost
+///         or quit and 1 if memory allocation fails.
 //---------------------------------------------------------------------------------------------------------------------
-void handleFlagCommand(myField **board, unsigned long long height, unsigned long long width, int i, int *remaining_flags, char **words)
+int processCommand(myGame *game, char *line, int *command)
 {
-  if (i < 3)
+  char *words[COMMAND_MAX_WORDS];
+  int i = splitCommandLine(line, words);
+  int parsed_command = i > 0 ? parseCommandName(words[0]) : COMMAND_UNKNOWN;
+  if (command != NULL)
   {
-    printf(COMMAND_MISSING_ARGUMENTS);
-    return;
-  }
-  else if (i > 3)
-  {
-    printf(TOO_MANY_ARGUMENTS);
-    return;
+    *command = parsed_command;
   }
-  else
+
+  if (parsed_command == COMMAND_UNKNOWN)
   {
-    if (!isInteger(words[1]) || !isInteger(words[2]))
+    printf(UNKNOWN_COMMAND);
+    if (i == 0)
     {
-      printf(INVALID_ARGUMENTS);
-      return;
+      return GAME_CONTINUE;
     }
-    int row = atoi(words[1]);
-    int col = atoi(words[2]);
+  }
+  unsigned long long begin = STATS_NOW();
+  int exit_code = GAME_CONTINUE;
+  long long flags_before = game->remaining_flags;
+  int result;
 
-    if (row >= height || col >= width)
-    {
-      printf(INVALID_COORDINATES);
-      return;
-    }
-    fieldFlag(board, row, col, remaining_flags);
-    printMap(board, height, width, *remaining_flags);
+  switch (parsed_command)
+  {
+    case COMMAND_START:
+      printf("\n");
+      clearHistory(&game->history); // the mines change, earlier moves cannot be undone
+      result = handleStartCommand(game->board, game->height, game->width, game->count, i, &game->remaining_flags,
+                                  game->seed, game->no_guess, game->procedural, game->engine, words);
+      game->prob_cache.valid = false;
+      if (result != 1)
+      {
+        game->board = NULL; // freed by the handler when the game ends
+        exit_code = result == 3 ? 1 : 0;
+      }
+      break;
+    case COMMAND_OPEN:
+      printf("\n");
+      game->board->history = &game->history;
+      beginMove(&game->history);
+      result = handleOpenCommand(game->board, game->height, game->width, i, &game->remaining_flags, game->engine,
+                                 words);
+      game->prob_cache.valid = false;
+      if (result != 1)
+      {
+        game->board = NULL;
+        exit_code = result == 3 ? 1 : 0;
+        break;
+      }
+      game->board->history = NULL;
+      endMove(&game->history, game->remaining_flags - flags_before);
+      break;
+    case COMMAND_FLAG:
+      printf("\n");
+      game->board->history = &game->history;
+      beginMove(&game->history);
+      handleFlagCommand(game->board, game->height, game->width, i, &game->remaining_flags, words);
+      game->board->history = NULL;
+      endMove(&game->history, game->remaining_flags - flags_before);
+      break;
+    case COMMAND_UNDO:
+    case COMMAND_REDO:
+      printf("\n");
+      handleUndoCommand(game->board, game->height, game->width, i, &game->remaining_flags, &game->history,
+                        parsed_command == COMMAND_REDO);
+      game->prob_cache.valid = false;
+      break;
+    case COMMAND_PROB:
+    case COMMAND_PROBMAP:
+      printf("\n");
+      handleProbCommand(game->board, game->height, game->width, i, game->remaining_flags, words, &game->prob_cache);
+      break;
+    case COMMAND_QUIT:
+      printf("\n");
+      if (game->board != NULL)
+      {
+        printMap(game->board, game->height, game->width, game->remaining_flags);
+      }
+      exit_code = 0;
+      break;
+    case COMMAND_STATS:
+      printf("\n");
+      printStats();
+      break;
+    case COMMAND_DUMP:
+      printf("\n");
+      handleDumpCommand(game->board, game->height, game->width, i, game->remaining_flags, words);
+      break;
+    case COMMAND_EXPORT:
+      printf("\n");
+      handleExportCommand(game->board, game->height, game->width, i, words);
+      break;
+    case COMMAND_REGION:
+      printf("\n");
+      handleRegionCommand(game->board, game->height, game->width, i, words);
+      break;
+    case COMMAND_SAVE:
+      if (i < 2)
+      {
+        printf("Error: Command is missing arguments!\n");
+      }
+      else
+      {
+        char *filename = words[1];
+        FILE *file_pointer = fopen(filename, "wb");
+        if (file_pointer == NULL)
+        {
+          printf(FAILED_TO_OPEN_FILE);
+        }
+        else
+        {
+          fclose(file_pointer);
+          saveGameStateToFile(filename, game->board, game->height, game->width);
+          printf("\n");
+        }
+      }
+      printMap(game->board, game->height, game->width, game->remaining_flags);
+      break;
+    case COMMAND_LOAD:
+      if (i < 2)
+      {
+        printf("Error: Command is missing arguments!\n");
+      }
+      else
+      {
+        char *filename = words[1];
+        result = loadGameStateFromFile(filename, game->board);
+        if (result == 2)
+        {
+          exit_code = 1;
+        }
+        else if (result == 0)
+        {
+          printf("\n");
+          game->height = game->board->height;
+          game->width = game->board->width;
+          game->engine = findBoardEngine(game->height, game->width);
+          game->remaining_flags = (long long)game->board->counters.mines - (long long)game->board->counters.flags;
+          game->prob_cache.valid = false;
+          clearHistory(&game->history);
+          printMap(game->board, game->height, game->width, game->remaining_flags);
+        }
+      }
+      break;
   }
+#ifdef A4_TIERED_BOARD
+  if (exit_code == GAME_CONTINUE && game->board != NULL && settleBoardTiles(game->board) != 0)
+  {
+    printf(OUT_OF_MEMORY);
+    exit_code = 1;
+  }
+#endif
+  recordCommand(parsed_command, begin);
+  return exit_code;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Saves the current game state to a file, including the board dimensions and the status of each field.
-/// @param filename The name of the file where the game state will be saved.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
+/// Executes all commands of a trace as fast as possible. Nothing is printed while replaying; afterwards the latency
+/// of every kind of command is reported.
+/// @param game The game with an allocated board, set up from the header of the trace.
+/// @param file The trace, positioned at the first command.
+/// @return Returns the exit code of the replayed game, 0 if the trace ends before the game, or 1 if the trace is
+///         invalid or memory allocation fails.
 //---------------------------------------------------------------------------------------------------------------------
-void saveGameStateToFile(char *filename, myField **board, unsigned long long height, unsigned long long width)
+int replayTrace(myGame *game, FILE *file)
 {
-  FILE *file_pointer = fopen(filename, "wb");
-  if (file_pointer == NULL)
+  char *line = NULL;
+  size_t line_capacity = 0;
+  unsigned long long delay;
+  unsigned long long recorded_ns = 0;
+  double *durations = NULL; // nanoseconds per command
+  int *kinds = NULL;        // index into stats_command_names per command
+  size_t durations_capacity = 0;
+  size_t kinds_capacity = 0;
+  size_t num_commands = 0;
+  int exit_code = GAME_CONTINUE;
+  int result = 0;
+
+  fflush(stdout);
+  int saved_stdout = dup(STDOUT_FILENO);
+  int null_output = open("/dev/null", O_WRONLY);
+  if (saved_stdout >= 0 && null_output >= 0)
   {
-    printf(FAILED_TO_OPEN_FILE);
-    return;
+    dup2(null_output, STDOUT_FILENO);
   }
+  render_suppressed = true;
+  unsigned long long replay_begin = nowNanoseconds();
 
-  fwrite(MAGIC_NUMBER, sizeof(char), 4, file_pointer);
-
-  uint64_t height64 = (uint64_t)height;
-  uint64_t width64 = (uint64_t)width;
-  fwrite(&height64, sizeof(height64), 1, file_pointer);
-  fwrite(&width64, sizeof(width64), 1, file_pointer);
+  while (exit_code == GAME_CONTINUE && (result = readTraceCommand(file, &line, &line_capacity, &delay)) == 0)
+  {
+    if (reserveArray((void **)&durations, &durations_capacity, num_commands + 1, sizeof(double)) != 0 ||
+        reserveArray((void **)&kinds, &kinds_capacity, num_commands + 1, sizeof(int)) != 0)
+    {
+      result = 3;
+      break;
+    }
+    recorded_ns += delay;
 
-  unsigned long long total_fields = height * width;
-  unsigned long long num_blocks = (total_fields + 7) / 8;
+    unsigned long long begin = nowNanoseconds();
+    exit_code = processCommand(game, line, &kinds[num_commands]);
+    durations[num_commands++] = nowNanoseconds() - begin;
+  }
+  free(line);
 
-  myBlockField *blocks = (myBlockField *)calloc(num_blocks, sizeof(myBlockField));
-  if (blocks == NULL)
+  unsigned long long replay_ns = nowNanoseconds() - replay_begin;
+  render_suppressed = false;
+  fflush(stdout);
+  if (saved_stdout >= 0 && null_output >= 0)
   {
-    printf(OUT_OF_MEMORY);
-    fclose(file_pointer);
-    return;
+    dup2(saved_stdout, STDOUT_FILENO);
+  }
+  if (saved_stdout >= 0)
+  {
+    close(saved_stdout);
+  }
+  if (null_output >= 0)
+  {
+    close(null_output);
   }
 
-  for (unsigned long long i = 0; i < total_fields; i++)
+  if (exit_code == GAME_CONTINUE && result != 1)
   {
-    unsigned long long block_index = i / 8;
-    unsigned long long bit_position = i % 8;
+    printf(result == 3 ? OUT_OF_MEMORY : INVALID_FILE_CONTENT);
+    free(durations);
+    free(kinds);
+    return 1;
+  }
 
-    if (board[i / width][i % width].is_flagged)
-    {
-      blocks[block_index].flag_bits |= 1 << bit_position;
-    }
-    if (board[i / width][i % width].is_opened)
+  printf("Replayed %zu commands in %.3f ms, recorded over %.3f s\n", num_commands, replay_ns / 1e6, recorded_ns / 1e9);
+  printf("%-10s %8s %12s %12s %12s %12s\n", "Command", "Count", "Total ms", "p50 us", "p99 us", "Max us");
+  double *samples = malloc((num_commands > 0 ? num_commands : 1) * sizeof(double));
+  for (int c = 0; samples != NULL && c < STATS_COMMANDS; c++)
+  {
+    size_t count = 0;
+    double total = 0.0;
+    for (size_t k = 0; k < num_commands; k++)
     {
-      blocks[block_index].open_bits |= 1 << bit_position;
+      if (kinds[k] == c)
+      {
+        samples[count++] = durations[k];
+        total += durations[k];
+      }
     }
-    if (board[i / width][i % width].is_bomb)
+    if (count > 0)
     {
-      blocks[block_index].mine_bits |= 1 << bit_position;
+      qsort(samples, count, sizeof(double), compareDurations);
+      printf("%-10s %8zu %12.3f %12.1f %12.1f %12.1f\n", stats_command_names[c], count, total / 1e6,
+             samples[(count - 1) / 2] / 1e3, samples[(count - 1) * 99 / 100] / 1e3, samples[count - 1] / 1e3);
     }
-    blocks[block_index].valid_bits |= 1 << bit_position;
   }
+  free(samples);
+  free(durations);
+  free(kinds);
+  return exit_code == GAME_CONTINUE ? 0 : exit_code;
+}
 
-  fwrite(blocks, sizeof(myBlockField), num_blocks, file_pointer);
-
-  free(blocks);
-  fclose(file_pointer);
+//---------------------------------------------------------------------------------------------------------------------
+/// Sets up a new game for a session with the settings of the server and a board from the pool, freeing its previous
+/// game.
+/// @param session The session.
+/// @param settings The game holding the size, number of mines and seed given on the command line.
+/// @param pool The pool of boards.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int startSessionGame(mySession *session, const myGame *settings, myBoardPool *pool)
+{
+  freeGame(&session->game);
+  memset(&session->game, 0, sizeof(myGame));
+  session->game.height = settings->height;
+  session->game.width = settings->width;
+  session->game.count = settings->count;
+  session->game.seed = settings->seed;
+  session->game.no_guess = settings->no_guess;
+  session->game.procedural = settings->procedural;
+  session->game.engine = settings->engine;
+  session->game.board = acquireMemoryBoard(pool, settings->height, settings->width, settings->procedural);
+  return session->game.board == NULL ? 1 : 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Loads the game state from a file, reconstructing the game board with its dimensions and the status of each field.
-/// @param filename The name of the file from which the game state is loaded.
-/// @param height A pointer to an integer where the height of the board will be stored.
-/// @param width A pointer to an integer where the width of the board will be stored.
-/// @return Returns a pointer to a 2D array of myField structures representing the loaded game board, or NULL on failure.
+/// Closes the connection of a session and frees it together with its game.
+/// @param epoll_fd The event loop of the server.
+/// @param sessions Pointer to the first session of the server.
+/// @param session The session.
 //---------------------------------------------------------------------------------------------------------------------
-myField **loadGameStateFromFile(char *filename, unsigned long long *height, unsigned long long *width)
+void closeSession(int epoll_fd, mySession **sessions, mySession *session)
 {
-  FILE *file_pointer = fopen(filename, "rb");
-  if (file_pointer == NULL)
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+  close(session->fd);
+  if (session->previous != NULL)
   {
-    printf(FAILED_TO_OPEN_FILE);
-    return NULL;
+    session->previous->next = session->next;
   }
-
-  char magic[4];
-  fread(magic, sizeof(char), 4, file_pointer);
-  if (strncmp(magic, MAGIC_NUMBER, 4) != 0)
+  else
   {
-    printf(INVALID_FILE_CONTENT);
-    fclose(file_pointer);
-    return NULL;
+    *sessions = session->next;
   }
-
-  uint64_t height64;
-  uint64_t width64;
-  fread(&height64, sizeof(height64), 1, file_pointer);
-  fread(&width64, sizeof(width64), 1, file_pointer);
-  *height = (unsigned long long)height64;
-  *width = (unsigned long long)width64;
-
-  myField **board = allocateMemoryBoard(*height, *width);
-  if (board == NULL)
+  if (session->next != NULL)
   {
-    fclose(file_pointer);
-    return NULL;
+    session->next->previous = session->previous;
   }
+  freeGame(&session->game);
+  free(session->reader.buffer);
+  fclose(session->capture);
+  free(session->captured);
+  free(session->output);
+  free(session);
+}
 
-  unsigned long long total_fields = (*height) * (*width);
-  unsigned long long num_blocks = (total_fields + 7) / 8;
-
-  myBlockField *blocks = (myBlockField *)malloc(num_blocks * sizeof(myBlockField));
-  if (blocks == NULL)
+//---------------------------------------------------------------------------------------------------------------------
+/// Sends as much of the pending responses of a session as the connection takes without blocking, and waits for the
+/// connection to take more or for the next request.
+/// @param epoll_fd The event loop of the server.
+/// @param session The session.
+/// @return Returns 0 on success or 1 if the connection failed.
+//---------------------------------------------------------------------------------------------------------------------
+int sendSessionOutput(int epoll_fd, mySession *session)
+{
+  while (session->output_sent < session->output_size)
   {
-    printf(OUT_OF_MEMORY);
-    freeMemoryBoard(board, *height);
-    fclose(file_pointer);
-    return NULL;
+    ssize_t bytes = send(session->fd, session->output + session->output_sent,
+                         session->output_size - session->output_sent, MSG_NOSIGNAL);
+    if (bytes < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      break;
+    }
+    if (bytes <= 0)
+    {
+      return 1;
+    }
+    session->output_sent += bytes;
   }
-
-  fread(blocks, sizeof(myBlockField), num_blocks, file_pointer);
-
-  for (unsigned long long i = 0; i < total_fields; i++)
+  if (session->output_sent == session->output_size)
   {
-    unsigned long long block_index = i / 8;
-    unsigned long long bit_position = i % 8;
+    session->output_size = 0;
+    session->output_sent = 0;
+  }
 
-    if (blocks[block_index].valid_bits & (1 << bit_position))
+  uint32_t events = session->output_size > 0 ? EPOLLOUT : EPOLLIN;
+  if (events != session->events)
+  {
+    struct epoll_event event = {.events = events, .data.ptr = session};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session->fd, &event) != 0)
     {
-      board[i / (*width)][i % (*width)].is_bomb = (blocks[block_index].mine_bits & (1 << bit_position)) != 0;
-      board[i / (*width)][i % (*width)].is_opened = (blocks[block_index].open_bits & (1 << bit_position)) != 0;
-      board[i / (*width)][i % (*width)].is_flagged = (blocks[block_index].flag_bits & (1 << bit_position)) != 0;
+      return 1;
     }
+    session->events = events;
   }
+  return 0;
+}
 
-  free(blocks);
-  fclose(file_pointer);
-  return board;
+//---------------------------------------------------------------------------------------------------------------------
+/// Executes one request of a session and appends the response: a line with the exit code of the command, -1 while
+/// the game goes on, and the number of bytes the command printed, followed by these bytes. While the command runs,
+/// stdout is the memory stream of the session, so the board goes through the render buffer into memory like any other
+/// output. When the game ends, the session starts a new one.
+/// @param session The session.
+/// @param line The request, a command line of the game.
+/// @param settings The game holding the size, number of mines and seed given on the command line.
+/// @param pool The pool of boards.
+/// @return Returns 0 on success or 1 if the output cannot be captured or memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int runSessionCommand(mySession *session, char *line, const myGame *settings, myBoardPool *pool)
+{
+  // the stream is emptied by going back to its start, the next flush cuts it there
+  FILE *console = stdout;
+  rewind(session->capture);
+  stdout = session->capture;
+  int exit_code = processCommand(&session->game, line, NULL);
+  int flushed = fflush(session->capture);
+  stdout = console;
+
+  size_t length = session->captured_size;
+  char header[32];
+  int header_length = snprintf(header, sizeof(header), "%d %zu\n", exit_code, length);
+  if (flushed != 0 || reserveArray((void **)&session->output, &session->output_capacity,
+                                   session->output_size + header_length + length, 1) != 0)
+  {
+    return 1;
+  }
+  memcpy(session->output + session->output_size, header, header_length);
+  session->output_size += header_length;
+  memcpy(session->output + session->output_size, session->captured, length);
+  session->output_size += length;
+
+  if (exit_code != GAME_CONTINUE)
+  {
+    return startSessionGame(session, settings, pool);
+  }
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Validates a given command against a list of known commands for the game.
-/// @param command The command string to validate.
+/// Executes the requests a session sent until a response cannot be sent without blocking or no complete request is
+/// left. A request longer than SERVER_MAX_LINE bytes ends the session.
+/// @param epoll_fd The event loop of the server.
+/// @param session The session.
+/// @param settings The game holding the size, number of mines and seed given on the command line.
+/// @param pool The pool of boards.
+/// @return Returns 0 if the session goes on or 1 if it ends.
 //---------------------------------------------------------------------------------------------------------------------
-void validateCommand(char *command)
+int handleSessionInput(int epoll_fd, mySession *session, const myGame *settings, myBoardPool *pool)
 {
-  if (strcmp(command, "start") != 0 && strcmp(command, "open") != 0 && strcmp(command, "flag") != 0 &&
-      strcmp(command, "dump") != 0 && strcmp(command, "save") != 0 && strcmp(command, "load") != 0 &&
-      strcmp(command, "quit") != 0)
+  while (session->output_size == 0)
   {
-    printf(UNKNOWN_COMMAND);
+    char *line;
+    int result = readCommandLine(&session->reader, &line);
+    if (result == 3)
+    {
+      return 0;
+    }
+    if (result != 0 || runSessionCommand(session, line, settings, pool) != 0 ||
+        sendSessionOutput(epoll_fd, session) != 0)
+    {
+      return 1;
+    }
   }
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-/// Counts the total number of bombs on the game board.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return The total number of bombs on the board.
+/// Accepts all pending connections, each a session with its own game.
+/// @param epoll_fd The event loop of the server.
+/// @param listen_fd The socket of the server.
+/// @param settings The game holding the size, number of mines and seed given on the command line.
+/// @param pool The pool of boards.
+/// @param sessions Pointer to the first session of the server, the new sessions are put in front.
 //---------------------------------------------------------------------------------------------------------------------
-int countBombs(myField **board, unsigned long long height, unsigned long long width)
+void acceptSessions(int epoll_fd, int listen_fd, const myGame *settings, myBoardPool *pool, mySession **sessions)
 {
-  int total_bombs = 0;
-  for (unsigned long long i = 0; i < height; i++)
+  while (true)
   {
-    for (unsigned long long j = 0; j < width; j++)
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return;
+    }
+    mySession *session = calloc(1, sizeof(mySession));
+    if (session == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) != 0)
+    {
+      free(session);
+      close(fd);
+      continue;
+    }
+    session->fd = fd;
+    session->reader.fd = fd;
+    session->reader.max_line = SERVER_MAX_LINE;
+    session->events = EPOLLIN;
+    session->capture = open_memstream(&session->captured, &session->captured_size);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = session};
+    if (session->capture == NULL || startSessionGame(session, settings, pool) != 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
     {
-      if (board[i][j].is_bomb == true)
+      freeGame(&session->game);
+      if (session->capture != NULL)
       {
-        total_bombs++;
+        fclose(session->capture);
       }
+      free(session->captured);
+      free(session);
+      close(fd);
+      continue;
+    }
+    session->next = *sessions;
+    if (*sessions != NULL)
+    {
+      (*sessions)->previous = session;
     }
+    *sessions = session;
   }
-  return total_bombs;
 }
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Stops the server once the event loop wakes up, the handler of SIGINT and SIGTERM.
+/// @param signal The number of the signal.
+//---------------------------------------------------------------------------------------------------------------------
+void stopServer(int signal)
+{
+  (void)signal;
+  server_stopped = 1;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
-/// Counts the total number of flags placed on the game board.
-/// @param board A 2D array of myField structures representing the game board.
-/// @param height The height of the game board.
-/// @param width The width of the game board.
-/// @return The total number of flags placed on the board.
+/// Serves games on a Unix socket until the server receives SIGINT or SIGTERM. Every connection is a session playing
+/// one game after another with the settings of the command line; it sends command lines and receives the output of
+/// each command. All sessions are handled by one event loop, and the boards of finished games are kept in a pool for
+/// new games. The signals are only taken while the loop waits, so a command always completes; the sessions are then
+/// closed and the socket is removed.
+/// @param settings The game holding the size, number of mines, seed and path of the socket.
+/// @return Returns 0 once the server is stopped by a signal, or 1 if the socket cannot be set up or the event loop
+///         fails.
 //---------------------------------------------------------------------------------------------------------------------
-int countFlags(myField **board, unsigned long long height, unsigned long long width)
+int runServer(const myGame *settings)
 {
-  int total_flags_places = 0;
-  for (unsigned long long i = 0; i < height; i++)
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(settings->serve_path) >= sizeof(address.sun_path))
   {
-    for (unsigned long long j = 0; j < width; j++)
+    printf(FAILED_TO_OPEN_FILE);
+    return 1;
+  }
+  strcpy(address.sun_path, settings->serve_path);
+  struct stat status;
+  if (stat(settings->serve_path, &status) == 0 && S_ISSOCK(status.st_mode))
+  {
+    unlink(settings->serve_path); // left behind by an earlier server
+  }
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  int epoll_fd = epoll_create1(0);
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+  if (listen_fd < 0 || epoll_fd < 0 || fcntl(listen_fd, F_SETFL, O_NONBLOCK) != 0 ||
+      bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, SERVER_BACKLOG) != 0 ||
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0)
+  {
+    printf(FAILED_TO_OPEN_FILE);
+    close(epoll_fd);
+    close(listen_fd);
+    return 1;
+  }
+
+  // the signals are blocked but while waiting for events, where they interrupt the wait
+  sigset_t stop_signals;
+  sigset_t waiting_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &stop_signals, &waiting_signals);
+  sigdelset(&waiting_signals, SIGINT);
+  sigdelset(&waiting_signals, SIGTERM);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stopServer;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  printf("Serving games on %s\n", settings->serve_path);
+  fflush(stdout);
+  myBoardPool pool;
+  memset(&pool, 0, sizeof(pool));
+  mySession *sessions = NULL;
+  struct epoll_event events[SERVER_EVENTS];
+
+  while (!server_stopped)
+  {
+    int ready = epoll_pwait(epoll_fd, events, SERVER_EVENTS, -1, &waiting_signals);
+    if (ready < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ready < 0)
+    {
+      break;
+    }
+    for (int e = 0; e < ready; e++)
     {
-      if (board[i][j].is_flagged == true)
+      mySession *session = events[e].data.ptr;
+      if (session == NULL)
+      {
+        acceptSessions(epoll_fd, listen_fd, settings, &pool, &sessions);
+        continue;
+      }
+      int ended = 0;
+      if (events[e].events & EPOLLOUT)
+      {
+        ended = sendSessionOutput(epoll_fd, session);
+      }
+      if (!ended && session->output_size == 0)
+      {
+        ended = handleSessionInput(epoll_fd, session, settings, &pool);
+      }
+      if (ended)
       {
-        total_flags_places++;
+        closeSession(epoll_fd, &sessions, session);
       }
     }
   }
-  return total_flags_places;
+
+  while (sessions != NULL)
+  {
+    closeSession(epoll_fd, &sessions, sessions);
+  }
+  freeBoardPool(&pool);
+  close(epoll_fd);
+  close(listen_fd);
+  unlink(settings->serve_path);
+  return server_stopped ? 0 : 1;
 }
 
+#ifndef A4_NO_MAIN // drivers such as bench.c include this file and bring their own main
 //---------------------------------------------------------------------------------------------------------------------
 /// The main function of the minesweeper game. It initializes the game, processes user commands, and manages the game state.
 /// @param argc The number of command-line arguments.
@@ -1288,175 +8363,109 @@ int countFlags(myField **board, unsigned long long height, unsigned long long wi
 //---------------------------------------------------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-  unsigned long long height = 9;
-  unsigned long long width = 9;
-  int count = 10; // number of mines
-  int seed = 0;
-  char line[101];
-  char command[11];
-  char *words[5];
-  myField **board = NULL;
-  int remaining_flags = 0;
+  myGame game;
+  memset(&game, 0, sizeof(game));
+  game.height = 9;
+  game.width = 9;
+  game.count = 10;
+  FILE *replay = NULL;
 
-  int exit_code = handleCommandLineArguments(argc, argv, &height, &width, &count, &seed);
+  int exit_code = handleCommandLineArguments(argc, argv, &game);
 
   if (exit_code != 0)
   {
     return exit_code;
   }
 
-  unsigned long long max_size = MAX_SIZE;
-  unsigned long long size_check = (unsigned long long)height * (unsigned long long)width;
+  if (game.replay_file != NULL)
+  {
+    replay = openReplayTrace(&game);
+    if (replay == NULL)
+    {
+      return 1;
+    }
+  }
 
-  if (size_check >= max_size)
+  // the number of fields must fit into 64 bits
+  if (game.height > (MAX_SIZE - 1) / game.width)
   {
     printf(OUT_OF_MEMORY);
     return 1;
   }
 
-  board = allocateMemoryBoard(height, width);
-  if (board == NULL)
+  if (game.games > 0)
   {
-    return 1;
+    return runSimulation(game.height, game.width, game.count, game.seed, game.no_guess, game.games, game.threads);
   }
 
-  printInitialMessage(height, width, count);
+  if (game.serve_path != NULL)
+  {
+    return runServer(&game);
+  }
 
-  while (1)
+  game.board = allocateMemoryBoard(game.height, game.width, game.procedural);
+  if (game.board == NULL)
   {
-    printf(" > ");
-    fgets(line, 100, stdin);
-    removeNewLine(line);
+    return 1;
+  }
 
-    if (strlen(line) == 0)
+  if (replay != NULL)
+  {
+    exit_code = replayTrace(&game, replay);
+    fclose(replay);
+    if (game.stats_on_exit)
     {
-      printf(UNKNOWN_COMMAND);
-      continue;
+      printStats();
     }
+    freeGame(&game);
+    return exit_code;
+  }
 
-    char *token = strtok(line, " \n");
-    int i = 0;
-    while (token != NULL)
-    {
-      words[i] = token;
-      i++;
-      token = strtok(NULL, " \n");
-    }
+  if (game.trace_file != NULL && createTrace(&game) != 0)
+  {
+    freeGame(&game);
+    return 1;
+  }
 
-    if (i == 0)
-    {
-      printf(UNKNOWN_COMMAND);
-      continue;
-    }
+  printInitialMessage(game.height, game.width, game.count);
 
-    strcpy(command, words[0]);
-    removeNewLine(command);
-    validateCommand(command);
+  myLineReader reader;
+  memset(&reader, 0, sizeof(reader));
+  reader.fd = STDIN_FILENO;
+  char *line;
 
-    if (strcmp(command, "start") == 0)
-    {
-      printf("\n");
-      int exit_code = handleStartCommand(board, height, width, count, i, &remaining_flags, seed, words);
-      if (exit_code == 1)
-      {
-        continue;
-      }
-      else
-      {
-        return 0;
-      }
-    }
-    else if (strcmp(command, "open") == 0)
-    {
-      printf("\n");
-      int exit_code = handleOpenCommand(board, height, width, i, &remaining_flags, words);
-      if (exit_code == 1)
-      {
-        continue;
-      }
-      else
-      {
-        return 0;
-      }
-    }
-    else if (strcmp(command, "flag") == 0)
-    {
-      printf("\n");
-      handleFlagCommand(board, height, width, i, &remaining_flags, words);
-    }
-    else if (strcmp(command, "quit") == 0)
+  while (1)
+  {
+    printf(" > ");
+    int result = readCommandLine(&reader, &line);
+    if (result == 0)
     {
-      printf("\n");
-      if (board != NULL)
+      if (game.trace != NULL)
       {
-        printMap(board, height, width, remaining_flags);
-        freeMemoryBoard(board, height);
-        board = NULL;
+        recordTraceCommand(&game, line);
       }
-      return 0;
-    }
-    else if (strcmp(command, "dump") == 0)
-    {
-      printf("\n");
-      printOpenedMap(board, height, width, remaining_flags);
-      printf("\n");
-      printMap(board, height, width, remaining_flags);
+      exit_code = processCommand(&game, line, NULL);
     }
-    else if (strcmp(command, "save") == 0)
+    else
     {
-      if (i < 2)
+      // the game ends with the input
+      if (result == 2)
       {
-        printf("Error: Command is missing arguments!\n");
-      }
-      else
-      {
-        char *filename = words[1];
-        FILE *file_pointer = fopen(filename, "wb");
-        if (file_pointer == NULL)
-        {
-          printf(FAILED_TO_OPEN_FILE);
-        }
-        else
-        {
-          fclose(file_pointer);
-          saveGameStateToFile(filename, board, height, width);
-          printf("\n");
-        }
+        printf(OUT_OF_MEMORY);
       }
-      printMap(board, height, width, remaining_flags);
+      exit_code = result == 2 ? 1 : 0;
     }
-    else if (strcmp(command, "load") == 0)
+
+    if (exit_code != GAME_CONTINUE)
     {
-      if (i < 2)
-      {
-        printf("Error: Command is missing arguments!\n");
-      }
-      else
+      if (game.stats_on_exit)
       {
-        char *filename = words[1];
-        unsigned long long new_height, new_width;
-        myField **new_board = loadGameStateFromFile(filename, &new_height, &new_width);
-        if (new_board != NULL)
-        {
-          printf("\n");
-          freeMemoryBoard(board, height);
-          board = new_board;
-          height = new_height;
-          width = new_width;
-
-          int total_bombs = countBombs(board, new_height, new_width);
-          int flags_placed = countFlags(board, new_height, new_width);
-
-          remaining_flags = total_bombs - flags_placed;
-          printMap(board, height, width, remaining_flags);
-        }
+        printStats();
       }
+      free(reader.buffer);
+      freeGame(&game);
+      return exit_code;
     }
   }
-
-  if (board != NULL)
-  {
-    freeMemoryBoard(board, height);
-  }
-  return 0;
 }
+#endif
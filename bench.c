@@ -0,0 +1,694 @@
+//---------------------------------------------------------------------------------------------------------------------
+//
+// Benchmark driver for the hot paths of the game: board allocation, map generation, the cascade of the first click,
+// counting the adjacent mines of every field, the win check, region queries, printing the map and saving and loading
+// the game. The first click is timed with the engine of a preset as well if the board has its size. Every operation
+// is timed on a matrix of board sizes and mine densities and reported as CSV (default) or JSON, with percentiles per
+// operation, so results can be compared across commits and board layouts. The tiered layout also plays a procedural
+// game of 10^10 fields, far beyond 2^31, opening and flagging fields all over it, and checks the board afterwards.
+//
+// Usage: ./a4_bench [--json] [--reps count] [--max-fields count]
+//
+//---------------------------------------------------------------------------------------------------------------------
+//
+
+#define A4_NO_MAIN
+#include "a4.c"
+
+#include <fcntl.h>
+
+#define BENCH_FILE "a4_bench.sav"
+#define BENCH_FIELDS_PER_REP 20000000ULL
+#define BENCH_STRESS_MOVES 10000 // fields opened or flagged all over the board of the stress case per repetition
+#define BENCH_STRESS_CHECKS 16    // fields above 2^32 whose mines and adjacent mines are checked per repetition
+#define BENCH_CHECK_FAILED "Check failed: %s!\n"
+#if defined(A4_TILED_BOARD)
+#define BENCH_LAYOUT "tiled"
+#elif defined(A4_TIERED_BOARD)
+#define BENCH_LAYOUT "tiered"
+#else
+#define BENCH_LAYOUT "row-major"
+#endif
+
+typedef struct _bench_case_
+{
+  unsigned long long height;
+  unsigned long long width;
+  double density;
+} myBenchCase;
+
+typedef struct _bench_options_
+{
+  bool json;
+  int reps;                      // 0 picks the repetitions from the board size
+  unsigned long long max_fields; // larger boards are skipped
+  bool first_result;
+} myBenchOptions;
+
+static const myBenchCase bench_cases[] = {
+    {9, 9, 0.12},       {16, 16, 0.16},      {16, 30, 0.21},      {100, 100, 0.05},   {100, 100, 0.12},
+    {100, 100, 0.20},   {316, 316, 0.05},    {316, 316, 0.12},    {316, 316, 0.20},   {1000, 1000, 0.05},
+    {1000, 1000, 0.12}, {1000, 1000, 0.20},
+};
+
+#ifdef A4_TIERED_BOARD
+static const myBenchCase stress_case = {100000, 100000, 0.15};
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the current time of the monotonic clock.
+/// @return The time in nanoseconds.
+//---------------------------------------------------------------------------------------------------------------------
+double benchNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Resets every field of a board to closed, unflagged and without adjacent mines, keeping the mines.
+/// @param board A myBoard structure representing the game board.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+//---------------------------------------------------------------------------------------------------------------------
+void resetBoard(myBoard *board, unsigned long long height, unsigned long long width)
+{
+  for (unsigned long long row = 0; row < height; row++)
+  {
+    for (unsigned long long col = 0; col < width; col++)
+    {
+      writeBoardField(board, row, col, (myField){readBoardField(board, row, col).is_bomb, false, 0, false});
+    }
+  }
+#ifdef A4_TIERED_BOARD
+  settleBoardTiles(board);
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Sorts the samples of one operation and prints their statistics as one CSV line or JSON object.
+/// @param options The benchmark options.
+/// @param bench_case The board size and density.
+/// @param mines The number of mines.
+/// @param operation The name of the operation.
+/// @param samples The duration of every repetition in nanoseconds.
+/// @param reps The number of repetitions.
+//---------------------------------------------------------------------------------------------------------------------
+void reportSamples(myBenchOptions *options, const myBenchCase *bench_case, unsigned long long mines,
+                   const char *operation, double *samples, int reps)
+{
+  qsort(samples, reps, sizeof(double), compareDurations);
+  double sum = 0.0;
+  for (int r = 0; r < reps; r++)
+  {
+    sum += samples[r];
+  }
+  double median = samples[(reps - 1) / 2];
+  double p90 = samples[(reps - 1) * 90 / 100];
+  double p99 = samples[(reps - 1) * 99 / 100];
+
+  if (options->json)
+  {
+    printf("%s\n  {\"layout\": \"" BENCH_LAYOUT "\", \"height\": %llu, \"width\": %llu, \"mines\": %llu, "
+           "\"density\": %.2f, \"operation\": \"%s\", \"reps\": %d, \"min_ns\": %.0f, \"median_ns\": %.0f, "
+           "\"p90_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f, \"mean_ns\": %.0f}",
+           options->first_result ? "" : ",", bench_case->height, bench_case->width, mines, bench_case->density,
+           operation, reps, samples[0], median, p90, p99, samples[reps - 1], sum / reps);
+  }
+  else
+  {
+    printf(BENCH_LAYOUT ",%llu,%llu,%llu,%.2f,%s,%d,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", bench_case->height,
+           bench_case->width, mines, bench_case->density, operation, reps, samples[0], median, p90, p99,
+           samples[reps - 1], sum / reps);
+  }
+  options->first_result = false;
+  fflush(stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Times all operations on one board size and density.
+/// @param options The benchmark options.
+/// @param bench_case The board size and density.
+/// @return Returns 0 on success or 1 if memory allocation fails.
+//---------------------------------------------------------------------------------------------------------------------
+int runBenchCase(myBenchOptions *options, const myBenchCase *bench_case)
+{
+  unsigned long long height = bench_case->height;
+  unsigned long long width = bench_case->width;
+  unsigned long long fields = height * width;
+  unsigned long long mines = (unsigned long long)(bench_case->density * fields);
+  mines = mines >= fields ? fields - 1 : mines;
+  unsigned long long starting_field = (height / 2) * width + width / 2;
+  int reps = options->reps;
+  if (reps == 0)
+  {
+    unsigned long long automatic = BENCH_FIELDS_PER_REP / fields;
+    reps = automatic < 5 ? 5 : (automatic > 201 ? 201 : (int)automatic);
+  }
+
+  double *samples = malloc(reps * sizeof(double));
+  myBoard *board = allocateMemoryBoard(height, width, false);
+  if (samples == NULL || board == NULL)
+  {
+    free(samples);
+    return 1;
+  }
+  double begin;
+  int seed;
+
+  for (int r = 0; r < reps; r++)
+  {
+    begin = benchNow();
+    myBoard *other = allocateMemoryBoard(height, width, false);
+    samples[r] = benchNow() - begin;
+    if (other == NULL)
+    {
+      free(samples);
+      freeMemoryBoard(board);
+      return 1;
+    }
+    freeMemoryBoard(other);
+  }
+  reportSamples(options, bench_case, mines, "allocateMemoryBoard", samples, reps);
+
+  for (int r = 0; r < reps; r++)
+  {
+    seed = r + 1;
+    begin = benchNow();
+    generateMap(board, height, width, mines, starting_field, &seed);
+    samples[r] = benchNow() - begin;
+  }
+  reportSamples(options, bench_case, mines, "generateMap", samples, reps);
+
+  long long remaining_flags = mines;
+  for (int r = 0; r < reps; r++)
+  {
+    seed = r + 1;
+    generateMap(board, height, width, mines, starting_field, &seed);
+    resetBoard(board, height, width);
+    remaining_flags = mines;
+    begin = benchNow();
+    openField(board, starting_field / width, starting_field % width, height, width, &remaining_flags);
+    samples[r] = benchNow() - begin;
+  }
+  reportSamples(options, bench_case, mines, "openField_first_click", samples, reps);
+
+  const myBoardEngine *engine = findBoardEngine(height, width);
+  if (engine != NULL)
+  {
+    for (int r = 0; r < reps; r++)
+    {
+      seed = r + 1;
+      generateMap(board, height, width, mines, starting_field, &seed);
+      resetBoard(board, height, width);
+      remaining_flags = mines;
+      begin = benchNow();
+      engine->open_field(board, starting_field / width, starting_field % width, &remaining_flags);
+      samples[r] = benchNow() - begin;
+    }
+    reportSamples(options, bench_case, mines, "openField_preset_first_click", samples, reps);
+  }
+
+  for (int r = 0; r < reps; r++)
+  {
+    volatile unsigned long long adjacent_bombs = 0;
+    begin = benchNow();
+    for (unsigned long long row = 0; row < height; row++)
+    {
+      for (unsigned long long col = 0; col < width; col++)
+      {
+        adjacent_bombs += countAdjacentBombs(board, row, col, height, width);
+      }
+    }
+    samples[r] = benchNow() - begin;
+  }
+  reportSamples(options, bench_case, mines, "countAdjacentBombs_all", samples, reps);
+
+  for (int r = 0; r < reps; r++)
+  {
+    begin = benchNow();
+    volatile int win = checkWinCondition(board);
+    samples[r] = benchNow() - begin;
+    (void)win;
+  }
+  reportSamples(options, bench_case, mines, "checkWinCondition", samples, reps);
+
+  unsigned long long sums[REGION_COUNTS];
+  for (int r = 0; r < reps; r++)
+  {
+    invalidateRegionIndex(board);
+    begin = benchNow();
+    int result = queryRegion(board, 0, 0, height - 1, width - 1, sums);
+    samples[r] = benchNow() - begin;
+    if (result != 0)
+    {
+      free(samples);
+      freeMemoryBoard(board);
+      return 1;
+    }
+  }
+  reportSamples(options, bench_case, mines, "queryRegion_build", samples, reps);
+
+  for (int r = 0; r < reps; r++)
+  {
+    begin = benchNow();
+    queryRegion(board, height / 4, width / 4, height - 1 - height / 4, width - 1 - width / 4, sums);
+    samples[r] = benchNow() - begin;
+  }
+  reportSamples(options, bench_case, mines, "queryRegion", samples, reps);
+
+  fflush(stdout);
+  int saved_stdout = dup(STDOUT_FILENO);
+  int null_output = open("/dev/null", O_WRONLY);
+  if (saved_stdout >= 0 && null_output >= 0)
+  {
+    dup2(null_output, STDOUT_FILENO);
+    for (int r = 0; r < reps; r++)
+    {
+      begin = benchNow();
+      printMap(board, height, width, remaining_flags);
+      fflush(stdout);
+      samples[r] = benchNow() - begin;
+    }
+    dup2(saved_stdout, STDOUT_FILENO);
+    reportSamples(options, bench_case, mines, "printMap", samples, reps);
+  }
+  if (saved_stdout >= 0)
+  {
+    close(saved_stdout);
+  }
+  if (null_output >= 0)
+  {
+    close(null_output);
+  }
+
+  for (int r = 0; r < reps; r++)
+  {
+    begin = benchNow();
+    saveGameStateToFile(BENCH_FILE, board, height, width);
+    samples[r] = benchNow() - begin;
+  }
+  reportSamples(options, bench_case, mines, "saveGameStateToFile", samples, reps);
+
+  myBoard *loaded = allocateMemoryBoard(1, 1, false);
+  for (int r = 0; r < reps; r++)
+  {
+    begin = benchNow();
+    int result = loaded != NULL ? loadGameStateFromFile(BENCH_FILE, loaded) : 2;
+    samples[r] = benchNow() - begin;
+    if (result != 0)
+    {
+      free(samples);
+      freeMemoryBoard(board);
+      if (loaded != NULL)
+      {
+        freeMemoryBoard(loaded);
+      }
+      return 1;
+    }
+  }
+  freeMemoryBoard(loaded);
+  reportSamples(options, bench_case, mines, "loadGameStateFromFile", samples, reps);
+
+  remove(BENCH_FILE);
+  free(samples);
+  freeMemoryBoard(board);
+  return 0;
+}
+
+#ifdef A4_TIERED_BOARD
+//---------------------------------------------------------------------------------------------------------------------
+/// Returns the position of one of the fields opened or flagged all over the board of the stress case.
+/// @param rep The repetition.
+/// @param move The move of the repetition.
+/// @param height The height of the game board.
+/// @param width The width of the game board.
+/// @param row Pointer to store the row of the field.
+/// @param col Pointer to store the column of the field.
+//---------------------------------------------------------------------------------------------------------------------
+void findStressField(int rep, int move, unsigned long long height, unsigned long long width, unsigned long long *row,
+                     unsigned long long *col)
+{
+  uint64_t hash = mixBits((uint64_t)rep * BENCH_STRESS_MOVES + move);
+  *row = (hash >> 32) % height;
+  *col = (hash & UINT32_MAX) % width;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Turns the result of openField in the stress case into one of runStressCase: a field which cannot be opened, or a
+/// mine being opened, fails the case instead of being taken for a failed allocation.
+/// @param result The result of openField.
+/// @return Returns 0 if the field was opened, 1 if memory allocation failed, or 2 otherwise.
+//---------------------------------------------------------------------------------------------------------------------
+int checkStressMove(int result)
+{
+  if (result == 3)
+  {
+    return 1;
+  }
+  if (result != 0)
+  {
+    printf(BENCH_CHECK_FAILED, "openField");
+    return 2;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Checks a board of the stress case after it was played against values counted again from its fields: the counters
+/// against the fields of the played tiles, the first fields of its moves above 2^32 against the hash of the game and
+/// their adjacent mines against the fields around them, and the region at its far corner against its fields one by one.
+/// @param board A myBoard structure representing the game board.
+/// @param rep The repetition the board was played in.
+/// @param mines The number of mines the board is expected to have.
+/// @param region The counts of the region at the far corner returned by queryRegion.
+/// @return Returns 0 if every check passes, otherwise 1 after printing the failed check.
+//---------------------------------------------------------------------------------------------------------------------
+int checkStressBoard(myBoard *board, int rep, unsigned long long mines, const unsigned long long region[REGION_COUNTS])
+{
+  unsigned long long height = stress_case.height;
+  unsigned long long width = stress_case.width;
+  myBoardCounters counters = {mines, 0, 0, 0};
+  const myBoardTiers *tiers = &board->tiers;
+  for (size_t slot = 0; slot < tiers->directory.capacity; slot++)
+  {
+    if (tiers->directory.values[slot] == SIZE_MAX)
+    {
+      continue;
+    }
+    unsigned long long tile = tiers->directory.keys[slot];
+    for (unsigned field = 0; field < BOARD_TILE * BOARD_TILE; field++)
+    {
+      unsigned long long row = tile / board->tile_columns * BOARD_TILE + (field >> BOARD_TILE_SHIFT);
+      unsigned long long col = tile % board->tile_columns * BOARD_TILE + (field & (BOARD_TILE - 1));
+      if (row >= height || col >= width)
+      {
+        continue;
+      }
+      myField value = readBoardField(board, row, col);
+      counters.flags += value.is_flagged;
+      counters.opened += value.is_opened;
+      counters.closed_safe += !value.is_opened && !value.is_bomb;
+    }
+  }
+  if (memcmp(&counters, &board->counters, sizeof(counters)) != 0)
+  {
+    printf(BENCH_CHECK_FAILED, "counters of the board");
+    return 1;
+  }
+
+  int checked = 0;
+  for (int move = 0; move < BENCH_STRESS_MOVES && checked < BENCH_STRESS_CHECKS; move++)
+  {
+    unsigned long long row;
+    unsigned long long col;
+    findStressField(rep, move, height, width, &row, &col);
+    if (row * width + col <= UINT32_MAX)
+    {
+      continue;
+    }
+    checked++;
+    myField value = readBoardField(board, row, col);
+    bool is_bomb = isProceduralMine(&board->procedural, row, col);
+    if (value.is_bomb != is_bomb || value.is_flagged != is_bomb || value.is_opened == is_bomb)
+    {
+      printf(BENCH_CHECK_FAILED, "field above 2^32");
+      return 1;
+    }
+    // countAdjacentBombs takes the hash, the fields are read through the tiles, and the field itself is included
+    int adjacent_bombs = 0;
+    for (unsigned long long new_row = row - 1; new_row != row + 2; new_row++)
+    {
+      for (unsigned long long new_col = col - 1; new_col != col + 2; new_col++)
+      {
+        adjacent_bombs += new_row < height && new_col < width && readBoardField(board, new_row, new_col).is_bomb;
+      }
+    }
+    if (countAdjacentBombs(board, row, col, height, width) != adjacent_bombs)
+    {
+      printf(BENCH_CHECK_FAILED, "adjacent mines above 2^32");
+      return 1;
+    }
+  }
+
+  unsigned long long counted[REGION_COUNTS] = {0};
+  for (unsigned long long row = height - 1000; row < height; row++)
+  {
+    for (unsigned long long col = width - 1000; col < width; col++)
+    {
+      myField value = readBoardField(board, row, col);
+      counted[REGION_MINES] += value.is_bomb;
+      counted[REGION_OPENED] += value.is_opened;
+      counted[REGION_FLAGGED] += value.is_flagged;
+    }
+  }
+  if (memcmp(counted, region, sizeof(counted)) != 0)
+  {
+    printf(BENCH_CHECK_FAILED, "region at the far corner");
+    return 1;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Plays a procedural game on the board of the stress case: the first click in the middle, then fields at positions
+/// spread over the whole board, whose indices do not fit into 32 bits, and region queries at its far corner. Every
+/// board is checked by checkStressBoard afterwards. Only the tiered layout, which stores the played tiles alone, fits
+/// a board of this size into memory.
+/// @param options The benchmark options.
+/// @return Returns 0 on success, 1 if memory allocation fails, or 2 if a move or a check fails.
+//---------------------------------------------------------------------------------------------------------------------
+int runStressCase(myBenchOptions *options)
+{
+  unsigned long long height = stress_case.height;
+  unsigned long long width = stress_case.width;
+  unsigned long long mines = (unsigned long long)(stress_case.density * height * width);
+  unsigned long long starting_field = (height / 2) * width + width / 2;
+  int reps = options->reps > 0 ? options->reps : 5;
+  double *samples = malloc(reps * sizeof(double));
+  myBoard **boards = calloc(reps, sizeof(myBoard *));
+  if (samples == NULL || boards == NULL)
+  {
+    free(samples);
+    free(boards);
+    return 1;
+  }
+  double begin;
+  int seed;
+  int result = 0;
+
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    begin = benchNow();
+    boards[r] = allocateMemoryBoard(height, width, true);
+    samples[r] = benchNow() - begin;
+    result = boards[r] == NULL;
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "allocateMemoryBoard_procedural", samples, reps);
+  }
+
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    seed = r + 1;
+    begin = benchNow();
+    generateProceduralMap(boards[r], height, width, mines, starting_field, &seed);
+    samples[r] = benchNow() - begin;
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "generateProceduralMap", samples, reps);
+  }
+
+  long long remaining_flags = mines;
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    begin = benchNow();
+    result = openField(boards[r], starting_field / width, starting_field % width, height, width, &remaining_flags);
+    samples[r] = benchNow() - begin;
+    result = checkStressMove(result);
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "openField_first_click", samples, reps);
+  }
+
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    // mines are flagged so the game goes on, every position claims a tile of its own
+    begin = benchNow();
+    for (int move = 0; move < BENCH_STRESS_MOVES && result == 0; move++)
+    {
+      unsigned long long row;
+      unsigned long long col;
+      findStressField(r, move, height, width, &row, &col);
+      if (readBoardField(boards[r], row, col).is_bomb)
+      {
+        fieldFlag(boards[r], row, col, &remaining_flags);
+      }
+      else
+      {
+        result = checkStressMove(openField(boards[r], row, col, height, width, &remaining_flags));
+      }
+    }
+    samples[r] = benchNow() - begin;
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "openField_spread", samples, reps);
+  }
+
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    volatile unsigned long long adjacent_bombs = 0;
+    begin = benchNow();
+    for (unsigned long long row = height - 100; row < height; row++)
+    {
+      for (unsigned long long col = width - 100; col < width; col++)
+      {
+        adjacent_bombs += countAdjacentBombs(boards[r], row, col, height, width);
+      }
+    }
+    samples[r] = benchNow() - begin;
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "countAdjacentBombs_corner", samples, reps);
+  }
+
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    begin = benchNow();
+    volatile int win = checkWinCondition(boards[r]);
+    samples[r] = benchNow() - begin;
+    (void)win;
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "checkWinCondition", samples, reps);
+  }
+
+  unsigned long long sums[REGION_COUNTS];
+  for (int r = 0; r < reps && result == 0; r++)
+  {
+    begin = benchNow();
+    result = queryRegion(boards[r], height - 1000, width - 1000, height - 1, width - 1, sums);
+    samples[r] = benchNow() - begin;
+    if (result == 0 && checkStressBoard(boards[r], r, mines, sums) != 0)
+    {
+      result = 2;
+    }
+  }
+  if (result == 0)
+  {
+    reportSamples(options, &stress_case, mines, "queryRegion_corner", samples, reps);
+  }
+
+  for (int r = 0; r < reps; r++)
+  {
+    if (boards[r] != NULL)
+    {
+      freeMemoryBoard(boards[r]);
+    }
+  }
+  free(boards);
+  free(samples);
+  return result;
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Runs all benchmark cases.
+/// @param options The benchmark options.
+/// @return Returns 0 on success, 1 if memory allocation fails, or 6 if a check of the stress case fails.
+//---------------------------------------------------------------------------------------------------------------------
+int runBenchmarks(myBenchOptions *options)
+{
+  if (options->json)
+  {
+    printf("[");
+  }
+  else
+  {
+    printf("layout,height,width,mines,density,operation,reps,min_ns,median_ns,p90_ns,p99_ns,max_ns,mean_ns\n");
+  }
+  for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++)
+  {
+    if (bench_cases[c].height * bench_cases[c].width > options->max_fields)
+    {
+      continue;
+    }
+    if (runBenchCase(options, &bench_cases[c]) != 0)
+    {
+      printf(OUT_OF_MEMORY);
+      return 1;
+    }
+  }
+#ifdef A4_TIERED_BOARD
+  int result = stress_case.height * stress_case.width <= options->max_fields ? runStressCase(options) : 0;
+  if (result == 1)
+  {
+    printf(OUT_OF_MEMORY);
+    return 1;
+  }
+  if (result != 0)
+  {
+    return 6;
+  }
+#endif
+  if (options->json)
+  {
+    printf("\n]\n");
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// The main function of the benchmark driver. It parses the options and runs the benchmarks.
+/// @param argc The number of command-line arguments.
+/// @param argv The array of command-line arguments.
+/// @return Returns 0 on success, 1 if memory allocation fails, 6 if a check of the stress case fails, or the error
+///         code of an invalid argument.
+//---------------------------------------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  myBenchOptions options;
+  memset(&options, 0, sizeof(options));
+  options.max_fields = ULLONG_MAX;
+  options.first_result = true;
+
+  for (int index = 1; index < argc; index++)
+  {
+    if (strcmp(argv[index], "--json") == 0)
+    {
+      options.json = true;
+    }
+    else if (strcmp(argv[index], "--reps") == 0 || strcmp(argv[index], "--max-fields") == 0)
+    {
+      int value;
+      int exit_code = validateCountArgument(index, argc, argv, false, &value);
+      if (exit_code != 0)
+      {
+        return exit_code;
+      }
+      if (argv[index][2] == 'r')
+      {
+        options.reps = value;
+      }
+      else
+      {
+        options.max_fields = value;
+      }
+      index += 1;
+    }
+    else
+    {
+      printf(UNEXPECTED_ARGUMENT);
+      return 3;
+    }
+  }
+
+  return runBenchmarks(&options);
+}
@@ -0,0 +1,100 @@
+//---------------------------------------------------------------------------------------------------------------------
+//
+// libFuzzer target for loading saved games. Every input is written to a scratch file and loaded into one board that is
+// kept across inputs, so the reuse of its memory is exercised as well. A successful load must leave counters on the
+// board that match its fields, a failed one must leave the board as it was.
+//
+// Usage: ./a4_fuzz [libFuzzer options] [corpus directory]
+//
+//---------------------------------------------------------------------------------------------------------------------
+//
+
+#define A4_NO_MAIN
+#include "a4.c"
+
+#define FUZZ_FILE_TEMPLATE "/tmp/a4_fuzz_XXXXXX"
+
+static char fuzz_file[] = FUZZ_FILE_TEMPLATE;
+static int fuzz_descriptor = -1;
+static myBoard *fuzz_board = NULL;
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Creates the scratch file and the board shared by all inputs and silences the messages of the game.
+/// @param argc A pointer to the number of command-line arguments.
+/// @param argv A pointer to the array of command-line arguments.
+/// @return Returns 0.
+//---------------------------------------------------------------------------------------------------------------------
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+  (void)argc;
+  (void)argv;
+  fuzz_descriptor = mkstemp(fuzz_file);
+  fuzz_board = allocateMemoryBoard(1, 1, false);
+  if (fuzz_descriptor < 0 || fuzz_board == NULL)
+  {
+    abort();
+  }
+  unlink(fuzz_file);
+  if (freopen("/dev/null", "w", stdout) == NULL)
+  {
+    abort();
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/// Loads one input as a saved game and checks the result.
+/// @param data The bytes of the input.
+/// @param size The number of bytes.
+/// @return Returns 0.
+//---------------------------------------------------------------------------------------------------------------------
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if (ftruncate(fuzz_descriptor, 0) != 0 || pwrite(fuzz_descriptor, data, size, 0) != (ssize_t)size)
+  {
+    abort();
+  }
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fuzz_descriptor);
+
+  unsigned long long height = fuzz_board->height;
+  unsigned long long width = fuzz_board->width;
+  int result = loadGameStateFromFile(path, fuzz_board);
+  if (result == 2)
+  {
+    resizeMemoryBoard(fuzz_board, 1, 1);
+    return 0;
+  }
+  if (result != 0)
+  {
+    if (fuzz_board->height != height || fuzz_board->width != width)
+    {
+      abort();
+    }
+    return 0;
+  }
+
+  myBoardCounters counted = {0, 0, 0, 0};
+  for (unsigned long long row = 0; row < fuzz_board->height; row++)
+  {
+    for (unsigned long long col = 0; col < fuzz_board->width; col++)
+    {
+      myField field = readBoardField(fuzz_board, row, col);
+      if (field.is_opened && field.is_flagged)
+      {
+        abort();
+      }
+      counted.mines += field.is_bomb;
+      counted.flags += field.is_flagged;
+      counted.opened += field.is_opened;
+      counted.closed_safe += !field.is_opened && !field.is_bomb;
+    }
+  }
+  const myBoardCounters *counters = &fuzz_board->counters;
+  if (counted.mines != counters->mines || counted.flags != counters->flags || counted.opened != counters->opened ||
+      counted.closed_safe != counters->closed_safe)
+  {
+    abort();
+  }
+  return 0;
+}